@@ -0,0 +1,361 @@
+/**
+ * @brief       - Scheduler benchmarks of the thread pools, against a thread
+ *                per task through `std::async`:
+ *                - empty: throughput of tasks that do nothing.
+ *                - fib: recursive fibonacci, a task per call above a cutoff.
+ *                - skynet: a 10-ary tree of tasks summing its leaves.
+ *                - nested_for: a parallel for whose every item is one, of
+ *                  `nested_grain` items per task.
+ *                - producers/K: K threads outside the pool submitting.
+ *                - ping_pong: round trips of one task through the pool.
+ *                Results go to stdout, or to `--out`, as JSON, and a summary
+ *                to stderr. `--sweep` runs the pools at 1, 2, 4... workers up
+ *                to `--threads` instead, and adds speedup and efficiency
+ *                tables to the summary and, with `--csv`, to a CSV file.
+ *
+ * Usage: bench [--threads N] [--reps N] [--filter substring] [--out file]
+ *              [--sweep] [--csv file]
+ */
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <thread_pool/thread_pool.hh>
+#include <thread_pool/stealing_thread_pool.hh>
+
+#include "bench.hh"
+#include "scaling.hh"
+
+namespace {
+
+    constexpr std::uint64_t empty_tasks = 100000;
+    constexpr unsigned fib_n = 27;
+    constexpr unsigned fib_cutoff = 12;
+    constexpr std::uint64_t skynet_size = 1000000;
+    constexpr std::uint64_t skynet_leaf = 100;
+    constexpr std::uint64_t nested_outer = 64;
+    constexpr std::uint64_t nested_inner = 256;
+    constexpr std::uint64_t nested_grain = 16;
+    constexpr std::uint64_t producer_tasks = 20000;
+    constexpr std::uint64_t ping_pong_rounds = 10000;
+
+    /* Flat workloads wait for their tasks in batches: a thread per task is
+     * only reclaimed once its future is waited for, and std::async runs out
+     * of threads long before 100000. */
+    constexpr std::uint64_t batch = 1024;
+
+    struct options {
+        unsigned threads {std::thread::hardware_concurrency()};
+        unsigned reps {10};
+        std::string filter {};
+        std::string out {};
+        std::string csv {};
+        bool sweep {false};
+    };
+
+    std::uint64_t fib_serial(unsigned n)
+    {
+        return n < 2 ? n : fib_serial(n - 1) + fib_serial(n - 2);
+    }
+
+    /* Calls above the cutoff, the tasks `fib` submits. */
+    std::uint64_t fib_tasks(unsigned n)
+    {
+        return n <= fib_cutoff ? 0 : 1 + fib_tasks(n - 1) + fib_tasks(n - 2);
+    }
+
+    template <typename Executor>
+    std::uint64_t fib(Executor &ex, unsigned n)
+    {
+        if (n <= fib_cutoff) {
+            return fib_serial(n);
+        }
+
+        auto child = ex.submit([&ex, n]() { return fib(ex, n - 1); });
+        std::uint64_t const right = fib(ex, n - 2);
+        return ex.await(child) + right;
+    }
+
+    template <typename Executor>
+    std::uint64_t skynet(Executor &ex, std::uint64_t first, std::uint64_t size)
+    {
+        if (size <= skynet_leaf) {
+            std::uint64_t sum = 0;
+            for (std::uint64_t i = first; i < first + size; i++) {
+                sum += i;
+            }
+
+            return sum;
+        }
+
+        std::uint64_t const step = size / 10;
+        std::vector<std::future<std::uint64_t>> children;
+        for (unsigned i = 0; i < 10; i++) {
+            children.push_back(ex.submit([&ex, first, step, i]() {
+                return skynet(ex, first + i * step, step);
+            }));
+        }
+
+        std::uint64_t sum = 0;
+        for (auto &child: children) {
+            sum += ex.await(child);
+        }
+
+        return sum;
+    }
+
+    /* Split [first, last) in halves, a task for each left half, down to
+     * ranges of `grain` items run in a loop. The grain bounds how many tasks
+     * a waiting task may run inline, and so the depth of its stack: on a pool
+     * that does not steal, `await()` runs whatever is queued first, which
+     * may be another range that waits in turn. */
+    template <typename Executor, typename F>
+    void parallel_for(Executor &ex, std::uint64_t first, std::uint64_t last,
+                      std::uint64_t grain, const F &f)
+    {
+        if (last - first <= grain) {
+            for (std::uint64_t i = first; i < last; i++) {
+                f(i);
+            }
+
+            return;
+        }
+
+        std::uint64_t const mid = first + (last - first) / 2;
+        auto left = ex.submit([&ex, first, mid, grain, &f]() {
+            parallel_for(ex, first, mid, grain, f);
+            return 0;
+        });
+        parallel_for(ex, mid, last, grain, f);
+        ex.await(left);
+    }
+
+    void wait_all(std::vector<std::future<void>> &futures)
+    {
+        for (auto &f: futures) {
+            f.get();
+        }
+
+        futures.clear();
+    }
+
+    template <typename T>
+    void check(const char *name, T got, T expected)
+    {
+        if (got != expected) {
+            std::cerr << name << ": got " << got << ", expected " << expected
+                      << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    template <typename Executor>
+    void run_suite(const std::string &executor,
+                   const options &opt,
+                   std::vector<larva::bench::result> &results)
+    {
+        auto const selected = [&opt](const std::string &name) {
+            return opt.filter.empty()
+                || name.find(opt.filter) != std::string::npos;
+        };
+        auto const add = [&](const std::string &name, auto body) {
+            if (!selected(name)) {
+                return;
+            }
+
+            results.push_back(larva::bench::measure(
+                name, executor, opt.threads, opt.reps, body));
+            const larva::bench::result &r = results.back();
+            std::cerr << std::left << std::setw(24) << executor
+                      << std::setw(16) << name << std::right
+                      << std::setw(12) << std::fixed << std::setprecision(3)
+                      << r.median() / 1e6 << " ms  " << std::setw(14)
+                      << std::setprecision(0) << r.ops_per_sec() << " ops/s"
+                      << std::endl;
+        };
+
+        Executor ex(opt.threads);
+
+        /* Waits from the benchmark thread use `get()`, so that it never runs
+         * the tasks it measures. */
+        add("empty", [&ex]() {
+            std::vector<std::future<void>> futures;
+            futures.reserve(batch);
+            for (std::uint64_t i = 0; i < empty_tasks; i++) {
+                futures.push_back(ex.submit([]() {}));
+                if (futures.size() == batch || i + 1 == empty_tasks) {
+                    wait_all(futures);
+                }
+            }
+
+            return empty_tasks;
+        });
+
+        add("fib", [&ex]() {
+            auto root = ex.submit([&ex]() { return fib(ex, fib_n); });
+            check("fib", root.get(), fib_serial(fib_n));
+            return fib_tasks(fib_n) + 1;
+        });
+
+        add("skynet", [&ex]() {
+            auto root = ex.submit([&ex]() {
+                return skynet(ex, 0, skynet_size);
+            });
+            check("skynet", root.get(), skynet_size * (skynet_size - 1) / 2);
+            return skynet_size / skynet_leaf;
+        });
+
+        add("nested_for", [&ex]() {
+            std::atomic<std::uint64_t> items {0};
+            auto root = ex.submit([&ex, &items]() {
+                parallel_for(ex, 0, nested_outer, 1, [&ex, &items](std::uint64_t) {
+                    parallel_for(ex, 0, nested_inner, nested_grain,
+                                 [&items](std::uint64_t) {
+                        items.fetch_add(1, std::memory_order_relaxed);
+                    });
+                });
+                return 0;
+            });
+            root.get();
+            check("nested_for", items.load(), nested_outer * nested_inner);
+            return nested_outer * nested_inner;
+        });
+
+        for (unsigned producers = 1; producers <= opt.threads;
+             producers *= 2)
+        {
+            add("producers/" + std::to_string(producers), [&ex, producers]() {
+                std::uint64_t const each = producer_tasks / producers;
+                std::atomic<std::uint64_t> done {0};
+                std::vector<std::thread> threads;
+                for (unsigned p = 0; p < producers; p++) {
+                    threads.emplace_back([&ex, &done, each]() {
+                        std::vector<std::future<void>> futures;
+                        futures.reserve(batch);
+                        for (std::uint64_t i = 0; i < each; i++) {
+                            futures.push_back(ex.submit([&done]() {
+                                done.fetch_add(1, std::memory_order_relaxed);
+                            }));
+                            if (futures.size() == batch || i + 1 == each) {
+                                wait_all(futures);
+                            }
+                        }
+                    });
+                }
+
+                for (auto &t: threads) {
+                    t.join();
+                }
+
+                check("producers", done.load(), each * producers);
+                return each * producers;
+            });
+        }
+
+        add("ping_pong", [&ex]() {
+            std::uint64_t ball = 0;
+            for (std::uint64_t i = 0; i < ping_pong_rounds; i++) {
+                ball = ex.submit([ball]() { return ball + 1; }).get();
+            }
+
+            check("ping_pong", ball, ping_pong_rounds);
+            return ping_pong_rounds;
+        });
+    }
+
+    bool parse(int argc, char **argv, options &opt)
+    {
+        for (int i = 1; i < argc; i++) {
+            bool const has_value = i + 1 < argc;
+            if (!std::strcmp(argv[i], "--threads") && has_value) {
+                opt.threads = std::strtoul(argv[++i], nullptr, 10);
+            } else if (!std::strcmp(argv[i], "--reps") && has_value) {
+                opt.reps = std::strtoul(argv[++i], nullptr, 10);
+            } else if (!std::strcmp(argv[i], "--filter") && has_value) {
+                opt.filter = argv[++i];
+            } else if (!std::strcmp(argv[i], "--out") && has_value) {
+                opt.out = argv[++i];
+            } else if (!std::strcmp(argv[i], "--csv") && has_value) {
+                opt.csv = argv[++i];
+            } else if (!std::strcmp(argv[i], "--sweep")) {
+                opt.sweep = true;
+            } else {
+                return false;
+            }
+        }
+
+        return opt.threads > 0 && opt.reps > 0;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    options opt;
+    if (!parse(argc, argv, opt)) {
+        std::cerr << "usage: " << argv[0] << " [--threads N] [--reps N]"
+                  << " [--filter substring] [--out file] [--sweep]"
+                  << " [--csv file]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<larva::bench::result> results;
+    if (opt.sweep) {
+        /* A thread per task does not depend on the worker count, so the
+         * std::async baseline is left out of the sweep. */
+        std::vector<unsigned> counts;
+        for (unsigned n = 1; n < opt.threads; n *= 2) {
+            counts.push_back(n);
+        }
+        counts.push_back(opt.threads);
+
+        for (unsigned n: counts) {
+            options at = opt;
+            at.threads = n;
+            run_suite<larva::bench::pool_executor<larva::thread_pool>>(
+                "thread_pool", at, results);
+            run_suite<larva::bench::pool_executor<larva::stealing_thread_pool>>(
+                "stealing_thread_pool", at, results);
+        }
+
+        std::vector<larva::bench::scaling_point> const points =
+            larva::bench::scaling(results);
+        larva::bench::write_scaling(std::cerr, points);
+        if (!opt.csv.empty()) {
+            std::ofstream csv(opt.csv);
+            larva::bench::write_scaling_csv(csv, points);
+            if (!csv) {
+                std::cerr << opt.csv << ": can not write the speedups"
+                          << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+    } else {
+        run_suite<larva::bench::pool_executor<larva::thread_pool>>(
+            "thread_pool", opt, results);
+        run_suite<larva::bench::pool_executor<larva::stealing_thread_pool>>(
+            "stealing_thread_pool", opt, results);
+        run_suite<larva::bench::async_executor>("std::async", opt, results);
+    }
+
+    if (opt.out.empty()) {
+        larva::bench::write_json(std::cout, results, opt.reps);
+    } else {
+        std::ofstream out(opt.out);
+        larva::bench::write_json(out, results, opt.reps);
+        if (!out) {
+            std::cerr << opt.out << ": can not write the results"
+                      << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,248 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <future>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__)
+#include <unistd.h>
+#endif
+
+#include <thread_pool/clock.hh>
+
+namespace larva::bench {
+
+    /**
+     * @brief       - Runs submitted to a pool of the library. `await()` is
+     *                for tasks: it runs other pending tasks until the future
+     *                is ready, so a task waiting on its children never holds
+     *                a worker idle.
+     */
+    template <typename Pool>
+    class pool_executor {
+        Pool _pool;
+
+    public:
+        explicit pool_executor(unsigned threads): _pool {threads} {}
+
+        template <typename F>
+        auto submit(F f)
+        {
+            return this->_pool.submit(std::move(f));
+        }
+
+        template <typename T>
+        T await(std::future<T> &f)
+        {
+            while (f.wait_for(std::chrono::seconds(0))
+                   != std::future_status::ready)
+            {
+                this->_pool.run_pending_task();
+            }
+
+            return f.get();
+        }
+
+        Pool &pool()
+        {
+            return this->_pool;
+        }
+    };
+
+    /**
+     * @brief       - Baseline: a thread per task through `std::async`.
+     */
+    class async_executor {
+    public:
+        explicit async_executor(unsigned) {}
+
+        template <typename F>
+        auto submit(F f)
+        {
+            return std::async(std::launch::async, std::move(f));
+        }
+
+        template <typename T>
+        T await(std::future<T> &f)
+        {
+            return f.get();
+        }
+    };
+
+    /**
+     * @brief       - Samples of one benchmark, in nanoseconds per repetition.
+     *                `ops` is what one repetition does, e.g. tasks run.
+     */
+    struct result {
+        std::string name;
+        std::string executor;
+        unsigned threads {0};
+        std::uint64_t ops {0};
+        std::vector<double> samples_ns {};
+
+        double median() const
+        {
+            return quantile(0.5);
+        }
+
+        double quantile(double q) const
+        {
+            if (this->samples_ns.empty()) {
+                return 0;
+            }
+
+            std::vector<double> s = this->samples_ns;
+            std::sort(s.begin(), s.end());
+            double const pos = q * (s.size() - 1);
+            std::size_t const lo = static_cast<std::size_t>(pos);
+            std::size_t const hi = std::min(lo + 1, s.size() - 1);
+            return s[lo] + (s[hi] - s[lo]) * (pos - lo);
+        }
+
+        double mean() const
+        {
+            double sum = 0;
+            for (double v: this->samples_ns) {
+                sum += v;
+            }
+
+            return this->samples_ns.empty() ? 0 : sum / this->samples_ns.size();
+        }
+
+        double stddev() const
+        {
+            if (this->samples_ns.size() < 2) {
+                return 0;
+            }
+
+            double const m = this->mean();
+            double sum = 0;
+            for (double v: this->samples_ns) {
+                sum += (v - m) * (v - m);
+            }
+
+            return std::sqrt(sum / (this->samples_ns.size() - 1));
+        }
+
+        /**
+         * @brief   - Half width of the 95% confidence interval of the mean,
+         *            from Student's t.
+         */
+        double ci95() const
+        {
+            static const double t[] = {
+                12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306,
+                2.262, 2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120,
+                2.110, 2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064,
+                2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+            std::size_t const n = this->samples_ns.size();
+            if (n < 2) {
+                return 0;
+            }
+
+            double const tn = n - 1 <= 30 ? t[n - 2] : 1.96;
+            return tn * this->stddev() / std::sqrt(static_cast<double>(n));
+        }
+
+        double ops_per_sec() const
+        {
+            double const m = this->median();
+            return m > 0 ? this->ops * 1e9 / m : 0;
+        }
+    };
+
+    /**
+     * @brief       - Time `reps` runs of `body`, after one warm-up run.
+     *                `body` returns the number of operations it did.
+     */
+    inline result measure(const std::string &name,
+                          const std::string &executor,
+                          unsigned threads,
+                          unsigned reps,
+                          const std::function<std::uint64_t()> &body)
+    {
+        result r {name, executor, threads};
+        r.ops = body();
+        for (unsigned i = 0; i < reps; i++) {
+            std::int64_t const start = larva::now_ns();
+            r.ops = body();
+            r.samples_ns.push_back(
+                static_cast<double>(larva::now_ns() - start));
+        }
+
+        return r;
+    }
+
+    inline std::string hostname()
+    {
+#if defined(__unix__)
+        char name[256] = {};
+        if (gethostname(name, sizeof(name) - 1) == 0) {
+            return name;
+        }
+#endif
+        return "unknown";
+    }
+
+    inline std::string json_string(const std::string &s)
+    {
+        std::string out = "\"";
+        for (char c: s) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+            }
+
+            out += c;
+        }
+
+        return out + "\"";
+    }
+
+    /**
+     * @brief       - Write the results as JSON, with the context they were
+     *                measured in and every sample, so that runs can be
+     *                compared later.
+     */
+    inline void write_json(std::ostream &os,
+                           const std::vector<result> &results,
+                           unsigned reps)
+    {
+        std::time_t const now = std::time(nullptr);
+        char date[32] = {};
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ",
+                      std::gmtime(&now));
+
+        os << "{\n  \"context\": {\"date\": " << json_string(date)
+           << ", \"host\": " << json_string(hostname())
+           << ", \"hardware_concurrency\": "
+           << std::thread::hardware_concurrency()
+           << ", \"reps\": " << reps << "},\n  \"benchmarks\": [";
+        for (std::size_t i = 0; i < results.size(); i++) {
+            const result &r = results[i];
+            os << (i ? ",\n" : "\n") << "    {\"name\": "
+               << json_string(r.name)
+               << ", \"executor\": " << json_string(r.executor)
+               << ", \"threads\": " << r.threads
+               << ", \"ops\": " << r.ops
+               << ", \"median_ns\": " << r.median()
+               << ", \"mean_ns\": " << r.mean()
+               << ", \"stddev_ns\": " << r.stddev()
+               << ", \"ci95_ns\": " << r.ci95()
+               << ", \"ops_per_sec\": " << r.ops_per_sec()
+               << ", \"samples_ns\": [";
+            for (std::size_t s = 0; s < r.samples_ns.size(); s++) {
+                os << (s ? ", " : "") << r.samples_ns[s];
+            }
+            os << "]}";
+        }
+
+        os << "\n  ]\n}\n";
+    }
+}
@@ -0,0 +1,411 @@
+/**
+ * @brief       - Keep baselines of the benchmark results and judge new runs
+ *                against them.
+ *
+ *                `compare save <dir> <results>` stores a result file of
+ *                `bench`, `open_loop` or `queues` as the baseline of the host
+ *                it was measured on, `<dir>/<host>-<kind>.json`.
+ *
+ *                `compare <baseline> <results>` compares a run against a
+ *                baseline file, or against the one of its host and kind when
+ *                `<baseline>` is a directory:
+ *                - bench: the samples of each benchmark go through a
+ *                  Mann-Whitney U test. A change of the median time beyond
+ *                  `--threshold` percent (5 by default) is a regression or an
+ *                  improvement only if the test finds it significant at
+ *                  `--alpha` (0.05 by default), noise otherwise.
+ *                - open_loop and queues only keep percentiles, so throughput
+ *                  and p99 latency are judged on the threshold alone.
+ *
+ *                Exits with 1 if anything regressed, 2 on errors.
+ *
+ * Usage: compare save <dir> <results>
+ *        compare [--threshold pct] [--alpha p] <baseline> <results>
+ */
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "json.hh"
+
+namespace {
+
+    constexpr int exit_regression = 1;
+    constexpr int exit_error = 2;
+
+    struct options {
+        double threshold {0.05};
+        double alpha {0.05};
+    };
+
+    enum class verdict { same, noise, better, worse };
+
+    struct counts {
+        unsigned compared {0};
+        unsigned worse {0};
+        unsigned better {0};
+    };
+
+    bool load(const std::string &path, larva::bench::json &out)
+    {
+        std::ifstream in(path);
+        std::stringstream text;
+        text << in.rdbuf();
+        if (!in || !larva::bench::json::parse(text.str(), out)) {
+            std::cerr << path << ": not a benchmark result" << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    /* Which tool wrote the results, from the array holding them. */
+    std::string kind_of(const larva::bench::json &results)
+    {
+        if (results["benchmarks"].type == larva::bench::json::kind::array) {
+            return "bench";
+        }
+
+        if (results["points"].type == larva::bench::json::kind::array) {
+            return "open_loop";
+        }
+
+        if (results["cells"].type == larva::bench::json::kind::array) {
+            return "queues";
+        }
+
+        return "";
+    }
+
+    std::string baseline_name(const larva::bench::json &results)
+    {
+        std::string host = results["context"]["host"].string;
+        for (char &c: host) {
+            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-') {
+                c = '_';
+            }
+        }
+
+        return (host.empty() ? "unknown" : host) + "-" + kind_of(results)
+             + ".json";
+    }
+
+    /**
+     * @brief       - Two-sided p-value of the Mann-Whitney U test that `a`
+     *                and `b` come from the same distribution, from the
+     *                normal approximation with tie and continuity
+     *                corrections.
+     */
+    double mann_whitney(const std::vector<double> &a,
+                        const std::vector<double> &b)
+    {
+        double const n1 = a.size();
+        double const n2 = b.size();
+        if (n1 == 0 || n2 == 0) {
+            return 1;
+        }
+
+        std::vector<std::pair<double, int>> all;
+        for (double v: a) {
+            all.push_back({v, 0});
+        }
+        for (double v: b) {
+            all.push_back({v, 1});
+        }
+        std::sort(all.begin(), all.end());
+
+        /* Tied values share the mean of their ranks. */
+        double rank_a = 0;
+        double ties = 0;
+        for (std::size_t i = 0; i < all.size();) {
+            std::size_t j = i;
+            while (j < all.size() && all[j].first == all[i].first) {
+                j++;
+            }
+
+            double const rank = (i + 1 + j) / 2.0;
+            double const t = j - i;
+            ties += t * t * t - t;
+            for (std::size_t k = i; k < j; k++) {
+                if (all[k].second == 0) {
+                    rank_a += rank;
+                }
+            }
+
+            i = j;
+        }
+
+        double const n = n1 + n2;
+        double const u = rank_a - n1 * (n1 + 1) / 2;
+        double const mu = n1 * n2 / 2;
+        double const sigma = std::sqrt(
+            n1 * n2 / 12 * ((n + 1) - ties / (n * (n - 1))));
+        if (sigma == 0) {
+            return 1;
+        }
+
+        double const z = std::max(0.0, std::fabs(u - mu) - 0.5) / sigma;
+        return std::erfc(z / std::sqrt(2.0));
+    }
+
+    const char *label(verdict v)
+    {
+        switch (v) {
+        case verdict::same: return "same";
+        case verdict::noise: return "noise";
+        case verdict::better: return "better";
+        default: return "REGRESSION";
+        }
+    }
+
+    /* `change` is relative, positive when the new run is slower or worse. */
+    void report(const std::string &key, const std::string &metric,
+                double change, const char *p_value, verdict v, counts &c)
+    {
+        c.compared++;
+        c.worse += v == verdict::worse;
+        c.better += v == verdict::better;
+        std::cout << std::left << std::setw(44) << key << std::setw(18)
+                  << metric << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(8) << change * 100
+                  << "%" << std::setw(10) << p_value << "  " << label(v)
+                  << std::endl;
+    }
+
+    std::vector<double> samples(const larva::bench::json &b)
+    {
+        std::vector<double> s;
+        for (const auto &v: b["samples_ns"].array) {
+            s.push_back(v.number);
+        }
+
+        return s;
+    }
+
+    double median(std::vector<double> s)
+    {
+        if (s.empty()) {
+            return 0;
+        }
+
+        std::sort(s.begin(), s.end());
+        std::size_t const mid = s.size() / 2;
+        return s.size() % 2 ? s[mid] : (s[mid - 1] + s[mid]) / 2;
+    }
+
+    void compare_benchmarks(const larva::bench::json &base,
+                            const larva::bench::json &run,
+                            const options &opt, counts &c)
+    {
+        auto const key = [](const larva::bench::json &b) {
+            return b["executor"].string + " " + b["name"].string + " @"
+                 + std::to_string(static_cast<unsigned>(
+                       b["threads"].number));
+        };
+
+        std::map<std::string, const larva::bench::json *> old;
+        for (const auto &b: base["benchmarks"].array) {
+            old[key(b)] = &b;
+        }
+
+        for (const auto &b: run["benchmarks"].array) {
+            auto const it = old.find(key(b));
+            if (it == old.end()) {
+                continue;
+            }
+
+            std::vector<double> const before = samples(*it->second);
+            std::vector<double> const after = samples(b);
+            double const m0 = median(before);
+            double const change = m0 > 0 ? median(after) / m0 - 1 : 0;
+            double const p = mann_whitney(before, after);
+
+            verdict v = verdict::same;
+            if (std::fabs(change) > opt.threshold) {
+                v = p >= opt.alpha ? verdict::noise
+                  : change > 0 ? verdict::worse : verdict::better;
+            }
+
+            char p_value[16];
+            std::snprintf(p_value, sizeof(p_value), "p=%.3f", p);
+            report(key(b), "median time", change, p_value, v, c);
+        }
+    }
+
+    /* Threshold only: a relative change of `metric`, where lower is better
+     * unless `higher_is_better`. */
+    void compare_metric(const std::string &key,
+                        const larva::bench::json &before,
+                        const larva::bench::json &after,
+                        const std::string &metric, bool higher_is_better,
+                        const options &opt, counts &c)
+    {
+        double const m0 = before[metric].number_or(0);
+        double const m1 = after[metric].number_or(0);
+        if (m0 <= 0) {
+            return;
+        }
+
+        double const change = higher_is_better ? 1 - m1 / m0 : m1 / m0 - 1;
+        verdict v = verdict::same;
+        if (std::fabs(change) > opt.threshold) {
+            v = change > 0 ? verdict::worse : verdict::better;
+        }
+
+        report(key, metric, change, "-", v, c);
+    }
+
+    void compare_entries(const larva::bench::json &base,
+                         const larva::bench::json &run,
+                         const std::string &array,
+                         std::string (*key)(const larva::bench::json &),
+                         const char *throughput,
+                         const options &opt, counts &c)
+    {
+        std::map<std::string, const larva::bench::json *> old;
+        for (const auto &e: base[array].array) {
+            old[key(e)] = &e;
+        }
+
+        for (const auto &e: run[array].array) {
+            auto const it = old.find(key(e));
+            if (it == old.end()) {
+                continue;
+            }
+
+            compare_metric(key(e), *it->second, e, throughput, true, opt, c);
+            compare_metric(key(e), *it->second, e, "p99_ns", false, opt, c);
+        }
+    }
+
+    std::string point_key(const larva::bench::json &p)
+    {
+        return p["executor"].string + " @"
+             + std::to_string(static_cast<long long>(
+                   p["target_per_sec"].number)) + "/s";
+    }
+
+    std::string cell_key(const larva::bench::json &q)
+    {
+        return q["queue"].string + " "
+             + std::to_string(static_cast<unsigned>(q["producers"].number))
+             + "x"
+             + std::to_string(static_cast<unsigned>(q["consumers"].number))
+             + " "
+             + std::to_string(static_cast<unsigned>(q["payload"].number))
+             + "B " + q["traffic"].string;
+    }
+
+    int save(const std::string &dir, const std::string &path)
+    {
+        larva::bench::json results;
+        if (!load(path, results)) {
+            return exit_error;
+        }
+
+        if (kind_of(results).empty()) {
+            std::cerr << path << ": unknown kind of result" << std::endl;
+            return exit_error;
+        }
+
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        std::filesystem::path const target =
+            std::filesystem::path(dir) / baseline_name(results);
+        std::filesystem::copy_file(
+            path, target, std::filesystem::copy_options::overwrite_existing,
+            ec);
+        if (ec) {
+            std::cerr << target.string() << ": " << ec.message() << std::endl;
+            return exit_error;
+        }
+
+        std::cout << "saved " << target.string() << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    int compare(std::string baseline, const std::string &path,
+                const options &opt)
+    {
+        larva::bench::json run, base;
+        if (!load(path, run)) {
+            return exit_error;
+        }
+
+        if (std::filesystem::is_directory(baseline)) {
+            baseline = (std::filesystem::path(baseline)
+                        / baseline_name(run)).string();
+        }
+
+        if (!load(baseline, base)) {
+            return exit_error;
+        }
+
+        std::string const kind = kind_of(run);
+        if (kind.empty() || kind != kind_of(base)) {
+            std::cerr << path << " and " << baseline
+                      << " do not hold the same kind of results"
+                      << std::endl;
+            return exit_error;
+        }
+
+        counts c;
+        if (kind == "bench") {
+            compare_benchmarks(base, run, opt, c);
+        } else if (kind == "open_loop") {
+            compare_entries(base, run, "points", point_key,
+                            "achieved_per_sec", opt, c);
+        } else {
+            compare_entries(base, run, "cells", cell_key,
+                            "ops_per_sec", opt, c);
+        }
+
+        std::cout << c.compared << " compared, " << c.worse
+                  << " regressed, " << c.better << " improved, threshold "
+                  << std::fixed << std::setprecision(1) << opt.threshold * 100
+                  << "%"
+                  << std::endl;
+        return c.worse ? exit_regression : EXIT_SUCCESS;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 4 && !std::strcmp(argv[1], "save")) {
+        return save(argv[2], argv[3]);
+    }
+
+    options opt;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        bool const has_value = i + 1 < argc;
+        if (!std::strcmp(argv[i], "--threshold") && has_value) {
+            opt.threshold = std::strtod(argv[++i], nullptr) / 100;
+        } else if (!std::strcmp(argv[i], "--alpha") && has_value) {
+            opt.alpha = std::strtod(argv[++i], nullptr);
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+
+    if (files.size() != 2) {
+        std::cerr << "usage: " << argv[0] << " save <dir> <results>\n"
+                  << "       " << argv[0]
+                  << " [--threshold pct] [--alpha p] <baseline> <results>"
+                  << std::endl;
+        return exit_error;
+    }
+
+    return compare(files[0], files[1], opt);
+}
@@ -0,0 +1,205 @@
+#pragma once
+#include <cctype>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace larva::bench {
+
+    /**
+     * @brief       - Just enough JSON to read back what the benchmarks write:
+     *                objects, arrays, numbers, strings, booleans and null.
+     *                Strings keep their escapes but `\"` and `\\`.
+     */
+    struct json {
+        enum class kind { null, boolean, number, string, array, object };
+
+        kind type {kind::null};
+        bool boolean {false};
+        double number {0};
+        std::string string {};
+        std::vector<json> array {};
+        std::map<std::string, json> object {};
+
+        /* Member `key`, or null if there is none. */
+        const json &operator[](const std::string &key) const
+        {
+            static const json none;
+            auto const it = this->object.find(key);
+            return it == this->object.end() ? none : it->second;
+        }
+
+        double number_or(double fallback) const
+        {
+            return this->type == kind::number ? this->number : fallback;
+        }
+
+        /**
+         * @brief   - Parse `text`. Returns false, leaving `out` partly
+         *            filled, if it is not valid JSON.
+         */
+        static bool parse(const std::string &text, json &out)
+        {
+            std::size_t pos = 0;
+            return parse_value(text, pos, out)
+                && (skip_space(text, pos), pos == text.size());
+        }
+
+    private:
+        static void skip_space(const std::string &s, std::size_t &pos)
+        {
+            while (pos < s.size()
+                   && std::isspace(static_cast<unsigned char>(s[pos])))
+            {
+                pos++;
+            }
+        }
+
+        static bool literal(const std::string &s, std::size_t &pos,
+                            const char *word)
+        {
+            std::string const w = word;
+            if (s.compare(pos, w.size(), w) != 0) {
+                return false;
+            }
+
+            pos += w.size();
+            return true;
+        }
+
+        static bool parse_string(const std::string &s, std::size_t &pos,
+                                 std::string &out)
+        {
+            if (s[pos] != '"') {
+                return false;
+            }
+
+            for (pos++; pos < s.size(); pos++) {
+                char c = s[pos];
+                if (c == '"') {
+                    pos++;
+                    return true;
+                }
+
+                if (c == '\\' && pos + 1 < s.size()) {
+                    c = s[++pos];
+                    if (c != '"' && c != '\\') {
+                        out += '\\';
+                    }
+                }
+
+                out += c;
+            }
+
+            return false;
+        }
+
+        static bool parse_value(const std::string &s, std::size_t &pos,
+                                json &out)
+        {
+            skip_space(s, pos);
+            if (pos >= s.size()) {
+                return false;
+            }
+
+            char const c = s[pos];
+            if (c == '{') {
+                out.type = kind::object;
+                pos++;
+                skip_space(s, pos);
+                if (pos < s.size() && s[pos] == '}') {
+                    pos++;
+                    return true;
+                }
+
+                for (;;) {
+                    std::string key;
+                    skip_space(s, pos);
+                    if (pos >= s.size() || !parse_string(s, pos, key)) {
+                        return false;
+                    }
+
+                    skip_space(s, pos);
+                    if (pos >= s.size() || s[pos++] != ':'
+                        || !parse_value(s, pos, out.object[key]))
+                    {
+                        return false;
+                    }
+
+                    skip_space(s, pos);
+                    if (pos >= s.size()) {
+                        return false;
+                    }
+
+                    if (s[pos] == '}') {
+                        pos++;
+                        return true;
+                    }
+
+                    if (s[pos++] != ',') {
+                        return false;
+                    }
+                }
+            }
+
+            if (c == '[') {
+                out.type = kind::array;
+                pos++;
+                skip_space(s, pos);
+                if (pos < s.size() && s[pos] == ']') {
+                    pos++;
+                    return true;
+                }
+
+                for (;;) {
+                    out.array.emplace_back();
+                    if (!parse_value(s, pos, out.array.back())) {
+                        return false;
+                    }
+
+                    skip_space(s, pos);
+                    if (pos >= s.size()) {
+                        return false;
+                    }
+
+                    if (s[pos] == ']') {
+                        pos++;
+                        return true;
+                    }
+
+                    if (s[pos++] != ',') {
+                        return false;
+                    }
+                }
+            }
+
+            if (c == '"') {
+                out.type = kind::string;
+                return parse_string(s, pos, out.string);
+            }
+
+            if (literal(s, pos, "null")) {
+                out.type = kind::null;
+                return true;
+            }
+
+            if (literal(s, pos, "true") || literal(s, pos, "false")) {
+                out.type = kind::boolean;
+                out.boolean = s[pos - 1] == 'e' && s[pos - 2] == 'u';
+                return true;
+            }
+
+            char *end = nullptr;
+            out.number = std::strtod(s.c_str() + pos, &end);
+            if (end == s.c_str() + pos) {
+                return false;
+            }
+
+            out.type = kind::number;
+            pos = end - s.c_str();
+            return true;
+        }
+    };
+}
@@ -0,0 +1,263 @@
+/**
+ * @brief       - Open-loop latency of the thread pools. Generator threads
+ *                submit at a fixed rate, each on its own schedule, whatever
+ *                the pool does with the tasks. A task's latency runs from the
+ *                time it was meant to be submitted to its end, so a generator
+ *                held up by a slow submit still charges the delay to every
+ *                task behind it: the coordinated-omission correction.
+ *
+ *                The rate doubles from `--rate` until the pool completes
+ *                tasks, on time, at less than 95% of the rate asked for,
+ *                the saturation point, or until it passes one task per
+ *                nanosecond. Each pool gets a latency-vs-throughput curve on
+ *                stderr, and the points go to stdout, or to `--out`, as JSON.
+ *
+ * Usage: open_loop [--threads N] [--generators N] [--rate tasks/s]
+ *                  [--duration ms] [--work ns] [--out file]
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <thread_pool/clock.hh>
+#include <thread_pool/latency_histogram.hh>
+#include <thread_pool/thread_pool.hh>
+#include <thread_pool/stealing_thread_pool.hh>
+
+#include "bench.hh"
+
+namespace {
+
+    /* One task per nanosecond, the resolution of the schedule. */
+    constexpr double max_rate = 1e9;
+
+    struct options {
+        unsigned threads {std::thread::hardware_concurrency()};
+        unsigned generators {2};
+        double rate {10000};
+        std::int64_t duration_ns {1000000000};
+        std::int64_t work_ns {0};
+        std::string out {};
+    };
+
+    struct load_point {
+        std::string executor;
+        double target {0};
+        double achieved {0};
+        std::int64_t lag_ns {0};        /* Generators behind schedule. */
+        larva::latency_summary latency {};
+    };
+
+    void spin_for(std::int64_t ns)
+    {
+        std::int64_t const end = larva::now_ns() + ns;
+        while (larva::now_ns() < end)
+        {}
+    }
+
+    /* Sleep while far from `when`, then spin, which the scheduler wakes
+     * too late from. */
+    void wait_until(std::int64_t when)
+    {
+        std::int64_t const ahead = when - larva::now_ns();
+        if (ahead > 100000) {
+            std::this_thread::sleep_for(
+                std::chrono::nanoseconds(ahead - 50000));
+        }
+
+        while (larva::now_ns() < when) {
+            std::this_thread::yield();
+        }
+    }
+
+    template <typename Pool>
+    load_point run_point(const std::string &executor,
+                         const options &opt,
+                         double rate)
+    {
+        Pool pool(opt.threads);
+        larva::latency_histogram latency;
+        std::atomic<std::uint64_t> completed {0};
+        std::atomic<std::int64_t> lag {0};
+
+        /* Generators interleave: generator g submits at start + (k * G + g)
+         * intervals. */
+        std::int64_t const interval =
+            static_cast<std::int64_t>(1e9 / rate);
+        std::uint64_t const tasks =
+            static_cast<std::uint64_t>(rate * opt.duration_ns / 1e9);
+        std::int64_t const start = larva::now_ns() + 1000000;
+
+        std::vector<std::thread> generators;
+        for (unsigned g = 0; g < opt.generators; g++) {
+            generators.emplace_back([&, g]() {
+                for (std::uint64_t k = g; k < tasks; k += opt.generators) {
+                    std::int64_t const intended = start + k * interval;
+                    wait_until(intended);
+                    pool.submit([&latency, &completed, intended,
+                                 work = opt.work_ns]() {
+                        if (work > 0) {
+                            spin_for(work);
+                        }
+
+                        latency.record_shared(static_cast<std::uint64_t>(
+                            larva::now_ns() - intended));
+                        completed.fetch_add(1, std::memory_order_relaxed);
+                    });
+                }
+
+                std::int64_t const behind =
+                    larva::now_ns() - (start + tasks * interval);
+                if (behind > 0) {
+                    lag.fetch_add(behind, std::memory_order_relaxed);
+                }
+            });
+        }
+
+        for (auto &t: generators) {
+            t.join();
+        }
+
+        /* Throughput is what completed by the time the generators are done,
+         * over the time that really passed, which generators falling behind
+         * stretch past the schedule. The backlog left is not counted. */
+        std::uint64_t const on_time = completed.load();
+        std::int64_t const elapsed = larva::now_ns() - start;
+        pool.wait_idle();
+
+        load_point p {executor, rate};
+        p.achieved = elapsed > 0 ? on_time * 1e9 / elapsed : 0;
+        p.lag_ns = lag.load() / opt.generators;
+        p.latency = larva::latency_summary::of(latency.snapshot());
+        return p;
+    }
+
+    template <typename Pool>
+    void sweep(const std::string &executor,
+               const options &opt,
+               std::vector<load_point> &points)
+    {
+        std::cerr << "\n" << executor << ", " << opt.threads << " workers, "
+                  << opt.generators << " generators\n" << std::right
+                  << std::setw(12) << "target/s" << std::setw(12)
+                  << "achieved/s" << std::setw(12) << "p50 us"
+                  << std::setw(12) << "p99 us" << std::setw(12) << "p99.9 us"
+                  << std::setw(12) << "max us" << std::endl;
+
+        for (double rate = opt.rate;; rate *= 2) {
+            if (rate > max_rate) {
+                std::cerr << "not saturated below " << std::setprecision(0)
+                          << max_rate << " tasks/s" << std::endl;
+                break;
+            }
+
+            load_point const p = run_point<Pool>(executor, opt, rate);
+            points.push_back(p);
+            std::cerr << std::fixed << std::setprecision(0)
+                      << std::setw(12) << p.target
+                      << std::setw(12) << p.achieved << std::setprecision(1)
+                      << std::setw(12) << p.latency.p50 / 1e3
+                      << std::setw(12) << p.latency.p99 / 1e3
+                      << std::setw(12) << p.latency.p999 / 1e3
+                      << std::setw(12) << p.latency.max / 1e3 << std::endl;
+
+            if (p.achieved < 0.95 * p.target) {
+                std::cerr << "saturated at " << std::setprecision(0)
+                          << p.achieved << " tasks/s" << std::endl;
+                break;
+            }
+        }
+    }
+
+    void write_json(std::ostream &os,
+                    const options &opt,
+                    const std::vector<load_point> &points)
+    {
+        os << "{\n  \"context\": {\"host\": "
+           << larva::bench::json_string(larva::bench::hostname())
+           << ", \"threads\": " << opt.threads
+           << ", \"generators\": " << opt.generators
+           << ", \"duration_ns\": " << opt.duration_ns
+           << ", \"work_ns\": " << opt.work_ns << "},\n  \"points\": [";
+        for (std::size_t i = 0; i < points.size(); i++) {
+            const load_point &p = points[i];
+            os << (i ? ",\n" : "\n") << "    {\"executor\": "
+               << larva::bench::json_string(p.executor)
+               << ", \"target_per_sec\": " << p.target
+               << ", \"achieved_per_sec\": " << p.achieved
+               << ", \"lag_ns\": " << p.lag_ns
+               << ", \"count\": " << p.latency.count
+               << ", \"mean_ns\": " << p.latency.mean
+               << ", \"p50_ns\": " << p.latency.p50
+               << ", \"p99_ns\": " << p.latency.p99
+               << ", \"p999_ns\": " << p.latency.p999
+               << ", \"max_ns\": " << p.latency.max << "}";
+        }
+
+        os << "\n  ]\n}\n";
+    }
+
+    bool parse(int argc, char **argv, options &opt)
+    {
+        for (int i = 1; i < argc; i++) {
+            bool const has_value = i + 1 < argc;
+            if (!std::strcmp(argv[i], "--threads") && has_value) {
+                opt.threads = std::strtoul(argv[++i], nullptr, 10);
+            } else if (!std::strcmp(argv[i], "--generators") && has_value) {
+                opt.generators = std::strtoul(argv[++i], nullptr, 10);
+            } else if (!std::strcmp(argv[i], "--rate") && has_value) {
+                opt.rate = std::strtod(argv[++i], nullptr);
+            } else if (!std::strcmp(argv[i], "--duration") && has_value) {
+                opt.duration_ns =
+                    std::strtoll(argv[++i], nullptr, 10) * 1000000;
+            } else if (!std::strcmp(argv[i], "--work") && has_value) {
+                opt.work_ns = std::strtoll(argv[++i], nullptr, 10);
+            } else if (!std::strcmp(argv[i], "--out") && has_value) {
+                opt.out = argv[++i];
+            } else {
+                return false;
+            }
+        }
+
+        /* At least one task per run, at most one per nanosecond. */
+        return opt.threads > 0 && opt.generators > 0 && opt.rate <= max_rate
+            && opt.duration_ns > 0 && opt.rate * opt.duration_ns >= 1e9;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    options opt;
+    if (!parse(argc, argv, opt)) {
+        std::cerr << "usage: " << argv[0] << " [--threads N]"
+                  << " [--generators N] [--rate tasks/s] [--duration ms]"
+                  << " [--work ns] [--out file]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<load_point> points;
+    sweep<larva::thread_pool>("thread_pool", opt, points);
+    sweep<larva::stealing_thread_pool>("stealing_thread_pool", opt, points);
+
+    if (opt.out.empty()) {
+        write_json(std::cout, opt, points);
+    } else {
+        std::ofstream out(opt.out);
+        write_json(out, opt, points);
+        if (!out) {
+            std::cerr << opt.out << ": can not write the results"
+                      << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
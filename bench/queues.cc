@@ -0,0 +1,345 @@
+/**
+ * @brief       - Matrix of the concurrent queues: every queue at 1, 2, 4...
+ *                producers times 1, 2, 4... consumers up to `--max`, for
+ *                payloads of 8, 64 and 256 bytes, under steady and bursty
+ *                traffic. Steady producers push as fast as they can, bursty
+ *                ones push `burst` items then pause. Each cell reports:
+ *                - ops/s: items through the queue over the wall time.
+ *                - latency percentiles from push to pop, per item.
+ *                - LLC misses per item, over every thread of the cell, when
+ *                  `perf_event_open` allows it.
+ *                `spsc_ring` only runs in the 1x1 cells. A summary goes to
+ *                stderr and the cells to stdout, or to `--out`, as JSON.
+ *
+ * Usage: queues [--max N] [--items N] [--out file]
+ */
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <threadsafe_container/queue.hh>
+#include <threadsafe_container/spsc_ring.hh>
+#include <thread_pool/clock.hh>
+#include <thread_pool/latency_histogram.hh>
+#include <thread_pool/perf_counters.hh>
+#include <thread_pool/stealing_queue.hh>
+
+#include "bench.hh"
+
+namespace {
+
+    constexpr unsigned burst = 64;
+    constexpr auto burst_pause = std::chrono::microseconds(50);
+
+    struct options {
+        unsigned max {64};
+        std::uint64_t items {100000};
+        std::string out {};
+    };
+
+    /* Push time first, padding up to `Size` bytes. */
+    template <std::size_t Size>
+    struct payload {
+        std::int64_t pushed {0};
+        std::array<char, Size - sizeof(std::int64_t)> pad {};
+    };
+
+    /* Same interface over every queue: push blocks until the item is in,
+     * try_pop does not block. */
+    template <typename T>
+    struct threadsafe_queue_adapter {
+        static constexpr const char *name = "threadsafe_queue";
+        larva::threadsafe_queue<T> q;
+
+        void push(T item)
+        {
+            this->q.push(std::move(item));
+        }
+
+        bool try_pop(T &item)
+        {
+            return this->q.try_pop(item);
+        }
+    };
+
+    /* Consumers take from the end opposite to the pushes, like thieves. */
+    template <typename T>
+    struct stealing_queue_adapter {
+        static constexpr const char *name = "stealing_queue";
+        larva::basic_stealing_queue<T> q;
+
+        void push(T item)
+        {
+            this->q.push(std::move(item));
+        }
+
+        bool try_pop(T &item)
+        {
+            return this->q.try_steal(item);
+        }
+    };
+
+    template <typename T>
+    struct spsc_ring_adapter {
+        static constexpr const char *name = "spsc_ring";
+        larva::spsc_ring<T> q {1024};
+
+        void push(T item)
+        {
+            while (!this->q.try_push(std::move(item))) {
+                std::this_thread::yield();
+            }
+        }
+
+        bool try_pop(T &item)
+        {
+            return this->q.consume([&item](T &&v) { item = std::move(v); },
+                                   1) == 1;
+        }
+    };
+
+    struct cell {
+        std::string queue;
+        unsigned producers {0};
+        unsigned consumers {0};
+        std::size_t payload {0};
+        bool bursty {false};
+        std::uint64_t items {0};
+        double ops_per_sec {0};
+        larva::latency_summary latency {};
+        bool llc_counted {false};
+        double llc_misses_per_op {0};
+    };
+
+    template <typename Queue, std::size_t Size>
+    cell run_cell(unsigned producers, unsigned consumers, bool bursty,
+                  std::uint64_t items)
+    {
+        typedef payload<Size> item_type;
+
+        Queue queue;
+        std::uint64_t const each = items / producers;
+        std::uint64_t const total = each * producers;
+        std::atomic<std::uint64_t> popped {0};
+        std::atomic<unsigned> ready {0};
+        std::atomic<bool> go {false};
+        std::vector<larva::histogram_snapshot> latencies(consumers);
+        std::vector<larva::perf_sample> misses(producers + consumers);
+        std::vector<char> counted(producers + consumers, 0);
+
+        /* Every thread counts itself from the start signal to its end. */
+        auto const count = [&](unsigned slot, auto body) {
+            larva::perf_counters counters;
+            larva::perf_sample before, after;
+            counters.open();
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+
+            bool const ok = counters.read(before);
+            body();
+            if (ok && counters.read(after)) {
+                misses[slot] = after - before;
+                counted[slot] = (counters.events()
+                                 & (1u << 2)) != 0;  /* llc_misses */
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (unsigned p = 0; p < producers; p++) {
+            threads.emplace_back([&, p]() {
+                count(p, [&]() {
+                    for (std::uint64_t i = 0; i < each; i++) {
+                        item_type item;
+                        item.pushed = larva::now_ns();
+                        queue.push(item);
+                        if (bursty && (i + 1) % burst == 0) {
+                            std::this_thread::sleep_for(burst_pause);
+                        }
+                    }
+                });
+            });
+        }
+
+        for (unsigned c = 0; c < consumers; c++) {
+            threads.emplace_back([&, c]() {
+                count(producers + c, [&]() {
+                    larva::latency_histogram latency;
+                    item_type item;
+                    while (popped.load(std::memory_order_relaxed) < total) {
+                        if (!queue.try_pop(item)) {
+                            std::this_thread::yield();
+                            continue;
+                        }
+
+                        latency.record(static_cast<std::uint64_t>(
+                            larva::now_ns() - item.pushed));
+                        popped.fetch_add(1, std::memory_order_relaxed);
+                    }
+
+                    latencies[c] = latency.snapshot();
+                });
+            });
+        }
+
+        while (ready.load() < producers + consumers) {
+            std::this_thread::yield();
+        }
+
+        std::int64_t const start = larva::now_ns();
+        go.store(true, std::memory_order_release);
+        for (auto &t: threads) {
+            t.join();
+        }
+        std::int64_t const elapsed = larva::now_ns() - start;
+
+        cell r {Queue::name, producers, consumers, Size, bursty, total};
+        r.ops_per_sec = elapsed > 0 ? total * 1e9 / elapsed : 0;
+
+        larva::histogram_snapshot latency;
+        for (const auto &h: latencies) {
+            latency += h;
+        }
+        r.latency = larva::latency_summary::of(latency);
+
+        std::uint64_t llc = 0;
+        for (std::size_t i = 0; i < misses.size(); i++) {
+            llc += misses[i].llc_misses;
+            r.llc_counted = r.llc_counted || counted[i] != 0;
+        }
+        r.llc_misses_per_op = total ? static_cast<double>(llc) / total : 0;
+        return r;
+    }
+
+    template <std::size_t Size>
+    void run_payload(const options &opt, std::vector<cell> &cells)
+    {
+        typedef payload<Size> item_type;
+
+        auto const report = [&cells](const cell &c) {
+            cells.push_back(c);
+            std::cerr << std::left << std::setw(18) << c.queue << std::right
+                      << std::setw(4) << c.producers << "x" << std::left
+                      << std::setw(4) << c.consumers << std::right
+                      << std::setw(5) << c.payload << "B "
+                      << std::left << std::setw(7)
+                      << (c.bursty ? "bursty" : "steady") << std::right
+                      << std::fixed << std::setprecision(0)
+                      << std::setw(12) << c.ops_per_sec << " ops/s"
+                      << std::setprecision(1)
+                      << "  p50 " << std::setw(9) << c.latency.p50 / 1e3
+                      << " us  p99 " << std::setw(9) << c.latency.p99 / 1e3
+                      << " us  llc/op ";
+            if (c.llc_counted) {
+                std::cerr << std::setprecision(2) << c.llc_misses_per_op;
+            } else {
+                std::cerr << "-";
+            }
+            std::cerr << std::endl;
+        };
+
+        for (bool bursty: {false, true}) {
+            for (unsigned p = 1; p <= opt.max; p *= 2) {
+                for (unsigned c = 1; c <= opt.max; c *= 2) {
+                    report(run_cell<threadsafe_queue_adapter<item_type>, Size>(
+                        p, c, bursty, opt.items));
+                    report(run_cell<stealing_queue_adapter<item_type>, Size>(
+                        p, c, bursty, opt.items));
+                    if (p == 1 && c == 1) {
+                        report(run_cell<spsc_ring_adapter<item_type>, Size>(
+                            p, c, bursty, opt.items));
+                    }
+                }
+            }
+        }
+    }
+
+    void write_json(std::ostream &os, const std::vector<cell> &cells)
+    {
+        os << "{\n  \"context\": {\"host\": "
+           << larva::bench::json_string(larva::bench::hostname())
+           << ", \"hardware_concurrency\": "
+           << std::thread::hardware_concurrency() << "},\n  \"cells\": [";
+        for (std::size_t i = 0; i < cells.size(); i++) {
+            const cell &c = cells[i];
+            os << (i ? ",\n" : "\n") << "    {\"queue\": "
+               << larva::bench::json_string(c.queue)
+               << ", \"producers\": " << c.producers
+               << ", \"consumers\": " << c.consumers
+               << ", \"payload\": " << c.payload
+               << ", \"traffic\": \"" << (c.bursty ? "bursty" : "steady")
+               << "\", \"items\": " << c.items
+               << ", \"ops_per_sec\": " << c.ops_per_sec
+               << ", \"p50_ns\": " << c.latency.p50
+               << ", \"p99_ns\": " << c.latency.p99
+               << ", \"p999_ns\": " << c.latency.p999
+               << ", \"max_ns\": " << c.latency.max
+               << ", \"llc_misses_per_op\": ";
+            if (c.llc_counted) {
+                os << c.llc_misses_per_op;
+            } else {
+                os << "null";
+            }
+            os << "}";
+        }
+
+        os << "\n  ]\n}\n";
+    }
+
+    bool parse(int argc, char **argv, options &opt)
+    {
+        for (int i = 1; i < argc; i++) {
+            bool const has_value = i + 1 < argc;
+            if (!std::strcmp(argv[i], "--max") && has_value) {
+                opt.max = std::strtoul(argv[++i], nullptr, 10);
+            } else if (!std::strcmp(argv[i], "--items") && has_value) {
+                opt.items = std::strtoull(argv[++i], nullptr, 10);
+            } else if (!std::strcmp(argv[i], "--out") && has_value) {
+                opt.out = argv[++i];
+            } else {
+                return false;
+            }
+        }
+
+        return opt.max > 0 && opt.items >= opt.max;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    options opt;
+    if (!parse(argc, argv, opt)) {
+        std::cerr << "usage: " << argv[0]
+                  << " [--max N] [--items N] [--out file]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<cell> cells;
+    run_payload<8>(opt, cells);
+    run_payload<64>(opt, cells);
+    run_payload<256>(opt, cells);
+
+    if (opt.out.empty()) {
+        write_json(std::cout, cells);
+    } else {
+        std::ofstream out(opt.out);
+        write_json(out, cells);
+        if (!out) {
+            std::cerr << opt.out << ": can not write the results"
+                      << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "bench.hh"
+
+namespace larva::bench {
+
+    /**
+     * @brief       - One benchmark of one executor at one worker count,
+     *                against the same benchmark at a single worker. The
+     *                bounds come from the confidence intervals of both means.
+     */
+    struct scaling_point {
+        std::string name;
+        std::string executor;
+        unsigned threads {0};
+        double mean_ns {0};
+        double ci95_ns {0};
+        double speedup {0};
+        double speedup_lo {0};
+        double speedup_hi {0};
+
+        double efficiency() const
+        {
+            return this->threads ? this->speedup / this->threads : 0;
+        }
+    };
+
+    /**
+     * @brief       - Speedup of every result over the result of the same
+     *                benchmark and executor at one worker. Results without
+     *                such a baseline, e.g. with more producers than one
+     *                worker allows, are left out.
+     */
+    inline std::vector<scaling_point> scaling(const std::vector<result> &results)
+    {
+        std::map<std::pair<std::string, std::string>, const result *> base;
+        for (const result &r: results) {
+            if (r.threads == 1) {
+                base[{r.executor, r.name}] = &r;
+            }
+        }
+
+        std::vector<scaling_point> points;
+        for (const result &r: results) {
+            auto const it = base.find({r.executor, r.name});
+            if (it == base.end() || r.mean() <= 0) {
+                continue;
+            }
+
+            const result &b = *it->second;
+            scaling_point p {r.name, r.executor, r.threads, r.mean(), r.ci95()};
+            p.speedup = b.mean() / r.mean();
+            p.speedup_lo = std::max(0.0, b.mean() - b.ci95())
+                         / (r.mean() + r.ci95());
+            p.speedup_hi = r.mean() > r.ci95()
+                         ? (b.mean() + b.ci95()) / (r.mean() - r.ci95())
+                         : p.speedup;
+            points.push_back(p);
+        }
+
+        std::stable_sort(points.begin(), points.end(),
+                         [](const scaling_point &a, const scaling_point &b) {
+                             return std::tie(a.executor, a.name, a.threads)
+                                  < std::tie(b.executor, b.name, b.threads);
+                         });
+        return points;
+    }
+
+    /**
+     * @brief       - A table per benchmark and executor: time, speedup with
+     *                its interval, and efficiency at each worker count.
+     */
+    inline void write_scaling(std::ostream &os,
+                              const std::vector<scaling_point> &points)
+    {
+        std::string current;
+        for (const scaling_point &p: points) {
+            std::string const title = p.executor + " " + p.name;
+            if (title != current) {
+                current = title;
+                os << "\n" << title << "\n" << std::right << std::setw(8)
+                   << "workers" << std::setw(22) << "mean ms (95% CI)"
+                   << std::setw(26) << "speedup (95% CI)" << std::setw(12)
+                   << "efficiency" << "\n";
+            }
+
+            os << std::fixed << std::setw(8) << p.threads
+               << std::setw(12) << std::setprecision(3) << p.mean_ns / 1e6
+               << " +- " << std::setw(6) << p.ci95_ns / 1e6
+               << std::setw(10) << std::setprecision(2) << p.speedup
+               << " [" << std::setw(5) << p.speedup_lo << ", "
+               << std::setw(5) << p.speedup_hi << "]"
+               << std::setw(11) << std::setprecision(0)
+               << p.efficiency() * 100 << "%\n";
+        }
+    }
+
+    inline void write_scaling_csv(std::ostream &os,
+                                  const std::vector<scaling_point> &points)
+    {
+        os << "benchmark,executor,workers,mean_ns,ci95_ns,"
+              "speedup,speedup_lo,speedup_hi,efficiency\n";
+        for (const scaling_point &p: points) {
+            os << p.name << "," << p.executor << "," << p.threads << ","
+               << p.mean_ns << "," << p.ci95_ns << "," << p.speedup << ","
+               << p.speedup_lo << "," << p.speedup_hi << ","
+               << p.efficiency() << "\n";
+        }
+    }
+}
@@ -0,0 +1,264 @@
+/**
+ * @brief       - Wake-up and handoff latency of the thread pools. A probe
+ *                task is submitted from outside the pool and waited for with
+ *                `get()`, which gives two delays:
+ *                - wake-up: from `submit()` to the first instruction of the
+ *                  task, which includes waking a parked or yielding worker.
+ *                - handoff: from the end of the task to `get()` returning,
+ *                  which is the cost of the future.
+ *                Each pool is probed in four states:
+ *                - parked: probes 1 ms apart, so every worker has parked.
+ *                - spinning: probes back to back, so workers are still
+ *                  yielding before parking.
+ *                - partial: half the workers run background tasks.
+ *                - saturated: twice as many background tasks as workers,
+ *                  so the probe also waits in the queue.
+ *                A summary goes to stderr, and the histograms to stdout, or
+ *                to `--out`, as JSON.
+ *
+ * Usage: wakeup [--threads N] [--probes N] [--out file]
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <thread_pool/clock.hh>
+#include <thread_pool/latency_histogram.hh>
+#include <thread_pool/thread_pool.hh>
+#include <thread_pool/stealing_thread_pool.hh>
+
+#include "bench.hh"
+
+namespace {
+
+    constexpr std::int64_t background_task_ns = 20000;
+    constexpr auto park_pause = std::chrono::milliseconds(1);
+
+    struct options {
+        unsigned threads {std::thread::hardware_concurrency()};
+        unsigned probes {2000};
+        std::string out {};
+    };
+
+    struct series {
+        std::string executor;
+        std::string state;
+        larva::histogram_snapshot wakeup {};
+        larva::histogram_snapshot handoff {};
+    };
+
+    void spin_for(std::int64_t ns)
+    {
+        std::int64_t const end = larva::now_ns() + ns;
+        while (larva::now_ns() < end)
+        {}
+    }
+
+    /* Keeps `count` tasks of `background_task_ns` in the pool until
+     * destroyed. They are topped up from a thread of their own: tasks
+     * submitted by a worker would stay in its private queue, ahead of the
+     * probes, and starve them on a pool that does not steal. */
+    template <typename Pool>
+    class background_load {
+        Pool &_pool;
+        std::atomic_bool _running {true};
+        std::atomic<unsigned> _in_flight {0};
+        std::thread _feeder;
+
+        void feed(unsigned count)
+        {
+            while (this->_running.load(std::memory_order_relaxed)) {
+                if (this->_in_flight.load(std::memory_order_relaxed)
+                    >= count)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                this->_in_flight.fetch_add(1, std::memory_order_relaxed);
+                this->_pool.submit([this]() {
+                    spin_for(background_task_ns);
+                    this->_in_flight.fetch_sub(1, std::memory_order_relaxed);
+                });
+            }
+        }
+
+    public:
+        background_load(Pool &pool, unsigned count):
+            _pool {pool},
+            _feeder {&background_load::feed, this, count}
+        {}
+
+        ~background_load()
+        {
+            this->_running = false;
+            this->_feeder.join();
+            this->_pool.wait_idle();
+        }
+    };
+
+    template <typename Pool>
+    series probe(const std::string &executor, const std::string &state,
+                 Pool &pool, unsigned probes, bool pause)
+    {
+        larva::latency_histogram wakeup;
+        larva::latency_histogram handoff;
+        for (unsigned i = 0; i < probes; i++) {
+            if (pause) {
+                std::this_thread::sleep_for(park_pause);
+            }
+
+            std::int64_t started = 0;
+            std::int64_t ended = 0;
+            std::int64_t const submitted = larva::now_ns();
+            pool.submit([&started, &ended]() {
+                started = larva::now_ns();
+                ended = larva::now_ns();
+            }).get();
+            std::int64_t const returned = larva::now_ns();
+
+            wakeup.record(static_cast<std::uint64_t>(started - submitted));
+            handoff.record(static_cast<std::uint64_t>(returned - ended));
+        }
+
+        return {executor, state, wakeup.snapshot(), handoff.snapshot()};
+    }
+
+    template <typename Pool>
+    void run(const std::string &executor, const options &opt,
+             std::vector<series> &out)
+    {
+        Pool pool(opt.threads);
+
+        /* Fewer probes while parked, each costs a millisecond. */
+        out.push_back(probe(executor, "parked", pool,
+                            std::max(1u, opt.probes / 4), true));
+        out.push_back(probe(executor, "spinning", pool, opt.probes, false));
+        {
+            background_load<Pool> load(pool, opt.threads / 2);
+            out.push_back(probe(executor, "partial", pool, opt.probes,
+                                false));
+        }
+        {
+            background_load<Pool> load(pool, opt.threads * 2);
+            out.push_back(probe(executor, "saturated", pool, opt.probes,
+                                false));
+        }
+    }
+
+    void print(const series &s)
+    {
+        for (const auto *h: {&s.wakeup, &s.handoff}) {
+            larva::latency_summary const l = larva::latency_summary::of(*h);
+            std::cerr << std::left << std::setw(22) << s.executor
+                      << std::setw(11) << s.state << std::setw(9)
+                      << (h == &s.wakeup ? "wake-up" : "handoff")
+                      << std::right << std::fixed << std::setprecision(1)
+                      << "p50 " << std::setw(9) << l.p50 / 1e3
+                      << " us  p99 " << std::setw(9) << l.p99 / 1e3
+                      << " us  p99.9 " << std::setw(9) << l.p999 / 1e3
+                      << " us  max " << std::setw(9) << l.max / 1e3
+                      << " us" << std::endl;
+        }
+    }
+
+    /* Summary and the non-empty buckets, as [upper bound ns, count]. */
+    void write_histogram(std::ostream &os, const larva::histogram_snapshot &h)
+    {
+        larva::latency_summary const l = larva::latency_summary::of(h);
+        os << "{\"count\": " << l.count << ", \"mean_ns\": " << l.mean
+           << ", \"p50_ns\": " << l.p50 << ", \"p99_ns\": " << l.p99
+           << ", \"p999_ns\": " << l.p999 << ", \"max_ns\": " << l.max
+           << ", \"buckets\": [";
+        bool first = true;
+        for (unsigned i = 0; i < larva::histogram_snapshot::bucket_count; i++) {
+            if (h.count_at(i)) {
+                os << (first ? "" : ", ") << "["
+                   << larva::histogram_snapshot::upper_bound_of(i) << ", "
+                   << h.count_at(i) << "]";
+                first = false;
+            }
+        }
+        os << "]}";
+    }
+
+    void write_json(std::ostream &os, const options &opt,
+                    const std::vector<series> &all)
+    {
+        os << "{\n  \"context\": {\"host\": "
+           << larva::bench::json_string(larva::bench::hostname())
+           << ", \"threads\": " << opt.threads
+           << ", \"probes\": " << opt.probes << "},\n  \"series\": [";
+        for (std::size_t i = 0; i < all.size(); i++) {
+            const series &s = all[i];
+            os << (i ? ",\n" : "\n") << "    {\"executor\": "
+               << larva::bench::json_string(s.executor)
+               << ", \"state\": " << larva::bench::json_string(s.state)
+               << ",\n     \"wakeup\": ";
+            write_histogram(os, s.wakeup);
+            os << ",\n     \"handoff\": ";
+            write_histogram(os, s.handoff);
+            os << "}";
+        }
+
+        os << "\n  ]\n}\n";
+    }
+
+    bool parse(int argc, char **argv, options &opt)
+    {
+        for (int i = 1; i < argc; i++) {
+            bool const has_value = i + 1 < argc;
+            if (!std::strcmp(argv[i], "--threads") && has_value) {
+                opt.threads = std::strtoul(argv[++i], nullptr, 10);
+            } else if (!std::strcmp(argv[i], "--probes") && has_value) {
+                opt.probes = std::strtoul(argv[++i], nullptr, 10);
+            } else if (!std::strcmp(argv[i], "--out") && has_value) {
+                opt.out = argv[++i];
+            } else {
+                return false;
+            }
+        }
+
+        return opt.threads > 0 && opt.probes > 0;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    options opt;
+    if (!parse(argc, argv, opt)) {
+        std::cerr << "usage: " << argv[0]
+                  << " [--threads N] [--probes N] [--out file]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<series> all;
+    run<larva::thread_pool>("thread_pool", opt, all);
+    run<larva::stealing_thread_pool>("stealing_thread_pool", opt, all);
+    for (const series &s: all) {
+        print(s);
+    }
+
+    if (opt.out.empty()) {
+        write_json(std::cout, opt, all);
+    } else {
+        std::ofstream out(opt.out);
+        write_json(out, opt, all);
+        if (!out) {
+            std::cerr << opt.out << ": can not write the results"
+                      << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,482 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "callsite.hh"
+#include "log_buffer.hh"
+#include "log_writer.hh"
+
+namespace larva
+{
+    /**
+     * @brief       - Records of the deferred logger, as they sit in the
+     *                rings and in binary log files:
+     *                - header: total size (u32), callsite id (u32) and
+     *                  system time in nanoseconds (i64).
+     *                - arguments: a tag byte, then 8 bytes for numbers and
+     *                  pointers, 1 for bools and chars, or a u32 length and
+     *                  the bytes for strings.
+     *                A binary file starts with `magic` and holds,
+     *                before the first record of each callsite, a definition
+     *                record: the id with `site_definition` set, then level
+     *                (u8), line (u32), file and function as strings, and
+     *                the format string of a formatted callsite.
+     *                Integers are in host byte order.
+     */
+    namespace binary_log
+    {
+        constexpr char magic[8] = {'L', 'A', 'R', 'V', 'A', 'L', 'O', 'G'};
+        constexpr std::uint32_t site_definition = 0x80000000u;
+        constexpr std::size_t header_size = 16;
+
+        enum class tag : std::uint8_t
+        {
+            i64 = 1,
+            u64,
+            f64,
+            boolean,
+            character,
+            string,
+            pointer
+        };
+
+        /* Start a record in `out`, with its size left to `finish()`. */
+        inline void begin(log_buffer &out,
+                          std::uint32_t site,
+                          std::int64_t time_ns)
+        {
+            std::uint32_t const size = 0;
+            out.clear();
+            out.append(reinterpret_cast<const char *>(&size), sizeof(size));
+            out.append(reinterpret_cast<const char *>(&site), sizeof(site));
+            out.append(reinterpret_cast<const char *>(&time_ns),
+                       sizeof(time_ns));
+        }
+
+        /* The finished record, with its size patched in. */
+        inline std::string_view finish(log_buffer &out)
+        {
+            std::uint32_t const size = static_cast<std::uint32_t>(out.size());
+            std::memcpy(out.data(), &size, sizeof(size));
+            return out.view();
+        }
+
+        inline void put(log_buffer &out, tag t, const void *data,
+                        std::size_t size)
+        {
+            out.push_back(static_cast<char>(t));
+            out.append(static_cast<const char *>(data), size);
+        }
+
+        inline void put_string(log_buffer &out, std::string_view s)
+        {
+            std::uint32_t const size = static_cast<std::uint32_t>(s.size());
+            put(out, tag::string, &size, sizeof(size));
+            out.append(s);
+        }
+
+        /* Raw bytes for what has a tag, text for the rest, as `<<` would
+         * have written it. */
+        template <typename T>
+        void encode(log_buffer &out, const T &value)
+        {
+            typedef std::decay_t<T> type;
+            if constexpr (std::is_same_v<type, bool>)
+            {
+                put(out, tag::boolean, &value, 1);
+            }
+            else if constexpr (std::is_same_v<type, char>
+                               || std::is_same_v<type, signed char>
+                               || std::is_same_v<type, unsigned char>)
+            {
+                put(out, tag::character, &value, 1);
+            }
+            else if constexpr (std::is_integral_v<type>
+                               && std::is_signed_v<type>)
+            {
+                std::int64_t const v = value;
+                put(out, tag::i64, &v, sizeof(v));
+            }
+            else if constexpr (std::is_integral_v<type>)
+            {
+                std::uint64_t const v = value;
+                put(out, tag::u64, &v, sizeof(v));
+            }
+            else if constexpr (std::is_floating_point_v<type>)
+            {
+                double const v = value;
+                put(out, tag::f64, &v, sizeof(v));
+            }
+            else if constexpr (std::is_same_v<T, const char *>
+                               || std::is_same_v<T, char *>)
+            {
+                put_string(out, value ? value : "(null)");
+            }
+            else if constexpr (std::is_null_pointer_v<type>)
+            {
+                put_string(out, "nullptr");
+            }
+            else if constexpr (std::is_convertible_v<const T &,
+                                                     std::string_view>)
+            {
+                put_string(out, std::string_view(value));
+            }
+            else if constexpr (std::is_pointer_v<type>
+                               && !std::is_function_v<
+                                   std::remove_pointer_t<type>>)
+            {
+                std::uint64_t const v = reinterpret_cast<std::uintptr_t>(
+                    static_cast<const void *>(value));
+                put(out, tag::pointer, &v, sizeof(v));
+            }
+            else
+            {
+                std::string text;
+                larva::format_to(text, value);
+                put_string(out, text);
+            }
+        }
+
+        /* Reads fixed-size fields off a record, failing past its end. */
+        class reader
+        {
+            const char *_at;
+            const char *_end;
+
+        public:
+            reader(const char *data, std::size_t size) : _at{data},
+                                                        _end{data + size}
+            {
+            }
+
+            bool done() const
+            {
+                return this->_at >= this->_end;
+            }
+
+            template <typename T>
+            bool get(T &out)
+            {
+                if (this->_end - this->_at < static_cast<long>(sizeof(T)))
+                {
+                    return false;
+                }
+
+                std::memcpy(&out, this->_at, sizeof(T));
+                this->_at += sizeof(T);
+                return true;
+            }
+
+            bool get_string(std::string_view &out)
+            {
+                std::uint32_t size;
+                if (!this->get(size) || this->_end - this->_at < size)
+                {
+                    return false;
+                }
+
+                out = {this->_at, size};
+                this->_at += size;
+                return true;
+            }
+        };
+
+        /* Append the text of the next argument of a record. Returns false
+         * if it is malformed. */
+        template <typename Out>
+        bool format_argument(reader &r, Out &out)
+        {
+            std::uint8_t t;
+            if (!r.get(t))
+            {
+                return false;
+            }
+
+            switch (static_cast<tag>(t))
+            {
+            case tag::i64:
+            {
+                std::int64_t v;
+                if (!r.get(v))
+                    return false;
+                larva::format_to(out, v);
+                break;
+            }
+            case tag::u64:
+            {
+                std::uint64_t v;
+                if (!r.get(v))
+                    return false;
+                larva::format_to(out, v);
+                break;
+            }
+            case tag::f64:
+            {
+                double v;
+                if (!r.get(v))
+                    return false;
+                larva::format_to(out, v);
+                break;
+            }
+            case tag::boolean:
+            {
+                bool v;
+                if (!r.get(v))
+                    return false;
+                larva::format_to(out, v);
+                break;
+            }
+            case tag::character:
+            {
+                char v;
+                if (!r.get(v))
+                    return false;
+                larva::format_to(out, v);
+                break;
+            }
+            case tag::string:
+            {
+                std::string_view v;
+                if (!r.get_string(v))
+                    return false;
+                larva::format_to(out, v);
+                break;
+            }
+            case tag::pointer:
+            {
+                std::uint64_t v;
+                if (!r.get(v))
+                    return false;
+                larva::format_to(out, reinterpret_cast<const void *>(
+                                          static_cast<std::uintptr_t>(v)));
+                break;
+            }
+            default:
+                return false;
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief       - Append the text of the arguments of a record, as
+         *                the synchronous logger would have written them:
+         *                one after another, or in the place of each `{}` of
+         *                `segments` for a formatted callsite. Returns false
+         *                on a malformed record.
+         */
+        template <typename Out>
+        bool format_arguments(reader &r, Out &out)
+        {
+            while (!r.done())
+            {
+                if (!binary_log::format_argument(r, out))
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        template <typename Out>
+        bool format_arguments(reader &r,
+                              const format_segment *segments,
+                              std::size_t count,
+                              Out &out)
+        {
+            for (std::size_t i = 0; i < count; i++)
+            {
+                if (!segments[i].argument)
+                {
+                    out.append(segments[i].text.data(),
+                               segments[i].text.size());
+                }
+                else if (!binary_log::format_argument(r, out))
+                {
+                    return false;
+                }
+            }
+
+            return r.done();
+        }
+
+        template <typename Out>
+        bool format_arguments(reader &r, const callsite &site, Out &out)
+        {
+            return site.formatted ? binary_log::format_arguments(
+                                        r, site.segments, site.segment_count,
+                                        out)
+                                  : binary_log::format_arguments(r, out);
+        }
+
+        /* "[LEVEL] file:line function(): ", the header of a text line. */
+        template <typename Out>
+        void format_header(log_level level,
+                           std::string_view file,
+                           std::uint32_t line,
+                           std::string_view function,
+                           Out &out)
+        {
+            std::string_view const name = log_level_name(level);
+            out.append("[", 1);
+            out.append(name.data(), name.size());
+            out.append("] ", 2);
+            out.append(file.data(), file.size());
+            out.append(":", 1);
+            larva::format_to(out, line);
+            out.append(" ", 1);
+            out.append(function.data(), function.size());
+            out.append("(): ", 4);
+        }
+
+        inline std::int64_t now_ns()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                .count();
+        }
+    }
+
+    /**
+     * @brief       - Sink of the deferred logger. In `text` mode it formats
+     *                the records on the writer thread. In `binary` mode it
+     *                writes them as they are, with the definition of each
+     *                callsite before its first record, for `log_decode` to
+     *                format offline.
+     */
+    class binary_sink
+    {
+    public:
+        enum class output
+        {
+            text,
+            binary
+        };
+
+    private:
+        output _output{output::text};
+        bool _started{false};
+        std::vector<const callsite *> _sites{};
+        std::vector<bool> _defined{};
+        std::string _staging{};
+        std::string _out{};
+
+    public:
+        void set_output(output o)
+        {
+            this->_output = o;
+            this->_started = false;
+            this->_defined.clear();
+        }
+
+        void write(int fd, iovec *iov, std::size_t count)
+        {
+            this->_staging.clear();
+            for (std::size_t i = 0; i < count; i++)
+            {
+                this->_staging.append(static_cast<const char *>(iov[i].iov_base),
+                                      iov[i].iov_len);
+            }
+
+            this->_out.clear();
+            if (this->_output == output::binary && !this->_started)
+            {
+                this->_out.append(binary_log::magic, sizeof(binary_log::magic));
+                this->_started = true;
+            }
+
+            std::size_t at = 0;
+            while (at + binary_log::header_size <= this->_staging.size())
+            {
+                const char *record = this->_staging.data() + at;
+                std::uint32_t size, id;
+                std::memcpy(&size, record, sizeof(size));
+                std::memcpy(&id, record + 4, sizeof(id));
+                if (size < binary_log::header_size
+                    || at + size > this->_staging.size())
+                {
+                    break;
+                }
+
+                const callsite *site = this->site(id);
+                if (site)
+                {
+                    if (this->_output == output::binary)
+                    {
+                        this->define(*site);
+                        this->_out.append(record, size);
+                    }
+                    else
+                    {
+                        binary_log::reader r(record + binary_log::header_size,
+                                             size - binary_log::header_size);
+                        binary_log::format_header(site->level, site->file,
+                                                  site->line, site->function,
+                                                  this->_out);
+                        binary_log::format_arguments(r, *site, this->_out);
+                        this->_out += '\n';
+                    }
+                }
+
+                at += size;
+            }
+
+            iovec out = {&this->_out[0], this->_out.size()};
+            larva::write_all(fd, &out, 1);
+        }
+
+    private:
+        const callsite *site(std::uint32_t id)
+        {
+            if (id >= this->_sites.size() || !this->_sites[id])
+            {
+                if (id >= this->_sites.size())
+                {
+                    this->_sites.resize(id + 1, nullptr);
+                }
+
+                this->_sites[id] = callsite::find(id);
+            }
+
+            return this->_sites[id];
+        }
+
+        void define(const callsite &site)
+        {
+            if (site.id < this->_defined.size() && this->_defined[site.id])
+            {
+                return;
+            }
+
+            if (site.id >= this->_defined.size())
+            {
+                this->_defined.resize(site.id + 1, false);
+            }
+            this->_defined[site.id] = true;
+
+            log_buffer record;
+            binary_log::begin(record, site.id | binary_log::site_definition, 0);
+            std::uint8_t const level = static_cast<std::uint8_t>(site.level);
+            std::uint32_t const line = static_cast<std::uint32_t>(site.line);
+            record.append(reinterpret_cast<const char *>(&level),
+                          sizeof(level));
+            record.append(reinterpret_cast<const char *>(&line), sizeof(line));
+            binary_log::put_string(record, site.file);
+            binary_log::put_string(record, site.function);
+            if (site.formatted)
+            {
+                binary_log::put_string(record, site.format);
+            }
+            binary_log::finish(record);
+            this->_out.append(record.data(), record.size());
+        }
+    };
+
+    typedef basic_log_writer<binary_sink> binary_log_writer;
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string_view>
+
+#include "log_format.hh"
+
+namespace larva
+{
+    enum class log_level
+    {
+        debug = 0,
+        info,
+        warn,
+        error,
+        fatal
+    };
+
+    inline const char *log_level_name(log_level level)
+    {
+        switch (level)
+        {
+        case log_level::debug:
+            return "DEBUG";
+        case log_level::info:
+            return "INFO";
+        case log_level::warn:
+            return "WARN";
+        case log_level::error:
+            return "ERROR";
+        case log_level::fatal:
+            return "FATAL";
+        }
+
+        return "";
+    }
+
+    /**
+     * @brief       - What is fixed about a log statement: level, file, line,
+     *                function and, for `LARVA_LOG_FORMAT`, the parsed format.
+     *                Each statement keeps one in a static, so it is
+     *                registered once, under a lock, and records only carry
+     *                its `id` and arguments.
+     */
+    struct callsite
+    {
+        log_level level;
+        const char *file;
+        int line;
+        const char *function;
+        bool formatted{false};
+        std::string_view format{};
+        const format_segment *segments{nullptr};
+        std::size_t segment_count{0};
+        std::uint32_t id;
+
+        callsite(log_level level,
+                 const char *file,
+                 int line,
+                 const char *function) : level{level},
+                                         file{file},
+                                         line{line},
+                                         function{function},
+                                         id{add(this)}
+        {
+        }
+
+        template <std::size_t N>
+        callsite(log_level level,
+                 const char *file,
+                 int line,
+                 const char *function,
+                 const log_format<N> &format) : level{level},
+                                                file{file},
+                                                line{line},
+                                                function{function},
+                                                formatted{true},
+                                                format{format.text},
+                                                segments{format.segments.data()},
+                                                segment_count{N},
+                                                id{add(this)}
+        {
+        }
+
+        callsite(const callsite &) = delete;
+        callsite &operator=(const callsite &) = delete;
+
+        /* The callsite registered as `id`, or null. */
+        static const callsite *find(std::uint32_t id)
+        {
+            registry &r = sites();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            return id < r.sites.size() ? r.sites[id] : nullptr;
+        }
+
+    private:
+        struct registry
+        {
+            std::deque<const callsite *> sites{};
+            std::mutex mutex{};
+        };
+
+        static registry &sites()
+        {
+            static registry r;
+            return r;
+        }
+
+        static std::uint32_t add(const callsite *site)
+        {
+            registry &r = sites();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.sites.push_back(site);
+            return static_cast<std::uint32_t>(r.sites.size() - 1);
+        }
+    };
+}
+
+/* The callsite of the statement it is expanded in, built on first use. */
+#define LARVA_CALLSITE(level)                                           \
+    [](const char *function) -> const larva::callsite & {               \
+        static const larva::callsite site{level, __FILE__, __LINE__,    \
+                                          function};                    \
+        return site;                                                    \
+    }(__func__)
@@ -0,0 +1,209 @@
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace larva
+{
+    /**
+     * @brief       - Buffer of one log record. Records up to
+     *                `inline_capacity` bytes stay inline; a longer one moves
+     *                to a buffer kept per thread, which only grows, so a
+     *                thread stops allocating once it has written its longest
+     *                record. A record built while another one on the same
+     *                thread holds that buffer gets a heap buffer of its own.
+     */
+    class log_buffer
+    {
+    public:
+        static constexpr std::size_t inline_capacity = 256;
+
+    private:
+        struct spill
+        {
+            std::string buffer{};
+            bool in_use{false};
+        };
+
+        char _inline[inline_capacity];
+        char *_data{_inline};
+        std::size_t _size{0};
+        std::size_t _capacity{inline_capacity};
+        spill *_spill{nullptr};
+        std::unique_ptr<spill> _owned{};
+
+    public:
+        log_buffer() = default;
+
+        log_buffer(const log_buffer &) = delete;
+        log_buffer &operator=(const log_buffer &) = delete;
+
+        ~log_buffer()
+        {
+            if (this->_spill && !this->_owned)
+            {
+                this->_spill->in_use = false;
+            }
+        }
+
+        void append(const char *data, std::size_t size)
+        {
+            if (this->_size + size > this->_capacity)
+            {
+                this->grow(this->_size + size);
+            }
+
+            std::memcpy(this->_data + this->_size, data, size);
+            this->_size += size;
+        }
+
+        void append(std::string_view s)
+        {
+            this->append(s.data(), s.size());
+        }
+
+        void push_back(char c)
+        {
+            this->append(&c, 1);
+        }
+
+        void clear()
+        {
+            this->_size = 0;
+        }
+
+        char *data()
+        {
+            return this->_data;
+        }
+
+        std::size_t size() const
+        {
+            return this->_size;
+        }
+
+        std::string_view view() const
+        {
+            return {this->_data, this->_size};
+        }
+
+    private:
+        void grow(std::size_t size)
+        {
+            if (!this->_spill)
+            {
+                static thread_local spill local;
+                if (local.in_use)
+                {
+                    this->_owned = std::make_unique<spill>();
+                    this->_spill = this->_owned.get();
+                }
+                else
+                {
+                    local.in_use = true;
+                    this->_spill = &local;
+                }
+            }
+
+            std::string &buffer = this->_spill->buffer;
+            if (buffer.size() < size)
+            {
+                buffer.resize(std::max(size, 2 * this->_capacity));
+            }
+
+            if (this->_data == this->_inline)
+            {
+                std::memcpy(&buffer[0], this->_inline, this->_size);
+            }
+
+            this->_data = &buffer[0];
+            this->_capacity = buffer.size();
+        }
+    };
+
+    /**
+     * @brief       - Append the text of `value` to `out`, as `<<` on a
+     *                stream with `std::boolalpha` would, without locales or
+     *                allocations: numbers go through `std::to_chars`,
+     *                strings are copied. Other types fall back to their
+     *                `<<` on a temporary stream. `Out` has
+     *                `append(const char *, size_t)`.
+     */
+    template <typename Out, typename T>
+    void format_to(Out &out, const T &value)
+    {
+        typedef std::decay_t<T> type;
+        if constexpr (std::is_same_v<type, bool>)
+        {
+            out.append(value ? "true" : "false", value ? 4 : 5);
+        }
+        else if constexpr (std::is_same_v<type, char>
+                           || std::is_same_v<type, signed char>
+                           || std::is_same_v<type, unsigned char>)
+        {
+            char const c = static_cast<char>(value);
+            out.append(&c, 1);
+        }
+        else if constexpr (std::is_integral_v<type>)
+        {
+            char text[24];
+            std::to_chars_result const r =
+                std::to_chars(text, text + sizeof(text), value);
+            out.append(text, r.ptr - text);
+        }
+        else if constexpr (std::is_floating_point_v<type>)
+        {
+            /* `<<` prints 6 significant digits by default. */
+            char text[32];
+            std::to_chars_result const r =
+                std::to_chars(text, text + sizeof(text),
+                              static_cast<double>(value),
+                              std::chars_format::general, 6);
+            out.append(text, r.ptr - text);
+        }
+        else if constexpr (std::is_same_v<T, const char *>
+                           || std::is_same_v<T, char *>)
+        {
+            const char *s = value ? value : "(null)";
+            out.append(s, std::strlen(s));
+        }
+        else if constexpr (std::is_null_pointer_v<type>)
+        {
+            out.append("nullptr", 7);
+        }
+        else if constexpr (std::is_convertible_v<const T &, std::string_view>)
+        {
+            std::string_view const s = value;
+            out.append(s.data(), s.size());
+        }
+        else if constexpr (std::is_pointer_v<type>
+                           && !std::is_function_v<std::remove_pointer_t<type>>)
+        {
+            std::uintptr_t const address =
+                reinterpret_cast<std::uintptr_t>(static_cast<const void *>(value));
+            if (!address)
+            {
+                out.append("0", 1);
+                return;
+            }
+
+            char text[2 + 2 * sizeof(address)] = {'0', 'x'};
+            std::to_chars_result const r =
+                std::to_chars(text + 2, text + sizeof(text), address, 16);
+            out.append(text, r.ptr - text);
+        }
+        else
+        {
+            std::ostringstream text;
+            text << std::boolalpha << value;
+            std::string const s = text.str();
+            out.append(s.data(), s.size());
+        }
+    }
+}
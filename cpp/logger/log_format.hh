@@ -0,0 +1,92 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <string_view>
+
+namespace larva
+{
+    /* A piece of a format string: literal text, or the place of the next
+     * argument. */
+    struct format_segment
+    {
+        std::string_view text{};
+        bool argument{false};
+    };
+
+    /**
+     * @brief       - Split `format` into segments, into `out` if it is not
+     *                null, and return how many there are. `{}` is an
+     *                argument, `{{` and `}}` are literal braces, any other
+     *                brace throws `std::invalid_argument`, which fails the
+     *                compilation when parsed in a constant expression.
+     */
+    constexpr std::size_t parse_format(std::string_view format,
+                                       format_segment *out = nullptr)
+    {
+        std::size_t count = 0;
+        std::size_t start = 0;
+        auto add = [&](std::string_view text, bool argument) {
+            if (argument || !text.empty())
+            {
+                if (out)
+                {
+                    out[count] = {text, argument};
+                }
+
+                count++;
+            }
+        };
+
+        for (std::size_t i = 0; i < format.size(); i++)
+        {
+            char const next = i + 1 < format.size() ? format[i + 1] : '\0';
+            if (format[i] == '{' && next == '}')
+            {
+                add(format.substr(start, i - start), false);
+                add({}, true);
+            }
+            else if ((format[i] == '{' && next == '{')
+                     || (format[i] == '}' && next == '}'))
+            {
+                add(format.substr(start, i + 1 - start), false);
+            }
+            else if (format[i] == '{' || format[i] == '}')
+            {
+                throw std::invalid_argument("unmatched brace in log format");
+            }
+            else
+            {
+                continue;
+            }
+
+            i++;
+            start = i + 1;
+        }
+
+        add(format.substr(start), false);
+        return count;
+    }
+
+    /**
+     * @brief       - A format string parsed at compile time, as
+     *                `LARVA_LOG_FORMAT` does:
+     *                static constexpr log_format<parse_format("...")> f{"..."};
+     */
+    template <std::size_t N>
+    struct log_format
+    {
+        std::string_view text;
+        std::array<format_segment, N> segments{};
+        std::size_t arity{0};
+
+        constexpr explicit log_format(std::string_view text) : text{text}
+        {
+            larva::parse_format(text, this->segments.data());
+            for (const format_segment &segment : this->segments)
+            {
+                this->arity += segment.argument;
+            }
+        }
+    };
+}
@@ -0,0 +1,177 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string_view>
+
+#include <sys/uio.h>
+
+namespace larva
+{
+    /**
+     * @brief       - Byte ring for the log records of one thread. The thread
+     *                appends whole records without locks, the writer thread
+     *                hands the bytes to its sink straight from the ring and
+     *                then releases them. Records never straddle a
+     *                publication, so the writer only sees complete records.
+     */
+    class log_ring
+    {
+        struct alignas(64) producer_side
+        {
+            std::atomic<std::size_t> tail{0};
+            std::size_t cached_head{0};
+            std::atomic<bool> appending{false};
+        };
+
+        struct alignas(64) consumer_side
+        {
+            std::atomic<std::size_t> head{0};
+        };
+
+        producer_side _producer;
+        consumer_side _consumer;
+        std::size_t _mask;
+        std::unique_ptr<char[]> _data;
+        std::atomic<bool> _retired{false};
+
+    public:
+        static constexpr std::size_t default_capacity = 64 * 1024;
+
+        /* The capacity is rounded up to a power of two. */
+        explicit log_ring(std::size_t capacity = default_capacity)
+        {
+            std::size_t size = 1;
+            while (size < capacity)
+            {
+                size <<= 1;
+            }
+
+            this->_mask = size - 1;
+            this->_data = std::make_unique<char[]>(size);
+        }
+
+        log_ring(const log_ring &) = delete;
+        log_ring &operator=(const log_ring &) = delete;
+
+        std::size_t capacity() const
+        {
+            return this->_mask + 1;
+        }
+
+        /**
+         * @brief       - Producer side. Append `first` then `second` as one
+         *                record, or nothing if they do not fit. Returns the
+         *                bytes in use after the append, 0 if it failed.
+         */
+        std::size_t try_append(std::string_view first,
+                               std::string_view second = {})
+        {
+            std::size_t const size = first.size() + second.size();
+            std::size_t const tail =
+                this->_producer.tail.load(std::memory_order_relaxed);
+            if (tail + size - this->_producer.cached_head > this->capacity())
+            {
+                this->_producer.cached_head =
+                    this->_consumer.head.load(std::memory_order_acquire);
+                if (tail + size - this->_producer.cached_head
+                    > this->capacity())
+                {
+                    return 0;
+                }
+            }
+
+            this->copy_in(tail, first.data(), first.size());
+            this->copy_in(tail + first.size(), second.data(), second.size());
+            this->_producer.tail.store(tail + size, std::memory_order_release);
+            return tail + size - this->_producer.cached_head;
+        }
+
+        /**
+         * @brief       - Consumer side. Describe the readable bytes in at
+         *                most two `iovec`, as the data may wrap around.
+         *                Returns how many were filled.
+         */
+        std::size_t readable(iovec out[2]) const
+        {
+            std::size_t const head =
+                this->_consumer.head.load(std::memory_order_relaxed);
+            std::size_t const size =
+                this->_producer.tail.load(std::memory_order_acquire) - head;
+            if (size == 0)
+            {
+                return 0;
+            }
+
+            std::size_t const offset = head & this->_mask;
+            std::size_t const first = std::min(size, this->capacity() - offset);
+            out[0] = {this->_data.get() + offset, first};
+            if (first == size)
+            {
+                return 1;
+            }
+
+            out[1] = {this->_data.get(), size - first};
+            return 2;
+        }
+
+        /* Consumer side: give back the first `size` readable bytes. */
+        void release(std::size_t size)
+        {
+            this->_consumer.head.store(
+                this->_consumer.head.load(std::memory_order_relaxed) + size,
+                std::memory_order_release);
+        }
+
+        bool empty() const
+        {
+            return this->_consumer.head.load(std::memory_order_acquire)
+                   == this->_producer.tail.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief       - Producer side. Bracket an append that the writer
+         *                must not miss: `begin_append()` is sequentially
+         *                consistent, so a producer that then reads the
+         *                writer as running is seen by a writer that stops
+         *                and then checks `appending()`.
+         */
+        void begin_append()
+        {
+            this->_producer.appending.store(true, std::memory_order_seq_cst);
+        }
+
+        void end_append()
+        {
+            this->_producer.appending.store(false, std::memory_order_release);
+        }
+
+        bool appending() const
+        {
+            return this->_producer.appending.load(std::memory_order_seq_cst);
+        }
+
+        /* Set once the owning thread has exited; the writer drops the ring
+         * after draining it. */
+        void retire()
+        {
+            this->_retired.store(true, std::memory_order_release);
+        }
+
+        bool retired() const
+        {
+            return this->_retired.load(std::memory_order_acquire);
+        }
+
+    private:
+        void copy_in(std::size_t index, const char *data, std::size_t size)
+        {
+            std::size_t const offset = index & this->_mask;
+            std::size_t const first = std::min(size, this->capacity() - offset);
+            std::memcpy(this->_data.get() + offset, data, first);
+            std::memcpy(this->_data.get(), data + first, size - first);
+        }
+    };
+}
@@ -0,0 +1,389 @@
+#pragma once
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "log_ring.hh"
+
+namespace larva
+{
+    /* Retry short writes and interrupts. Other errors drop the data: there
+     * is nowhere left to report them. */
+    inline void write_all(int fd, iovec *iov, std::size_t count)
+    {
+        while (count)
+        {
+            ssize_t n = ::writev(fd, iov, static_cast<int>(count));
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                return;
+            }
+
+            while (count && static_cast<std::size_t>(n) >= iov->iov_len)
+            {
+                n -= iov->iov_len;
+                iov++;
+                count--;
+            }
+
+            if (count)
+            {
+                iov->iov_base = static_cast<char *>(iov->iov_base) + n;
+                iov->iov_len -= n;
+            }
+        }
+    }
+
+    /**
+     * @brief       - Sinks turn the records gathered by the writer into
+     *                output. `write(fd, iov, count)` gets whole records, in
+     *                the order each thread appended them. The text sink's
+     *                records are finished lines, written as they are.
+     */
+    struct text_sink
+    {
+        void write(int fd, iovec *iov, std::size_t count)
+        {
+            larva::write_all(fd, iov, count);
+        }
+    };
+
+    /**
+     * @brief       - Background writer of the asynchronous logger. Each
+     *                thread appends its records to a `log_ring` of its own,
+     *                without locks, and the writer thread gathers every ring
+     *                into one call of the sink per round, one `writev()` for
+     *                text. The writer sleeps up to `poll_interval` between
+     *                rounds and is only woken early when a ring is half full,
+     *                so callers do not make system calls.
+     *                Records of one thread stay in order; records of
+     *                different threads are interleaved by rounds.
+     */
+    template <typename Sink>
+    class basic_log_writer
+    {
+    public:
+        static constexpr auto poll_interval = std::chrono::milliseconds(1);
+        static constexpr std::size_t max_iovecs = 64;
+
+    private:
+        /* Owned by each thread that logged, retires its ring on exit. */
+        struct ring_handle
+        {
+            std::shared_ptr<log_ring> ring;
+
+            ~ring_handle()
+            {
+                if (this->ring)
+                {
+                    this->ring->retire();
+                }
+            }
+        };
+
+        Sink _sink{};
+        std::atomic<bool> _running{false};
+        std::atomic<bool> _sleeping{false};
+        int _fd{STDERR_FILENO};
+        std::thread _thread{};
+        std::mutex _start_mutex{};
+
+        /* Rings of every thread that logged. The writer copies the list when
+         * `_generation` moved. */
+        std::mutex _rings_mutex{};
+        std::vector<std::shared_ptr<log_ring>> _rings{};
+        std::atomic<unsigned> _generation{0};
+
+        /* Sinks may keep state, so direct writes from callers are
+         * serialized with the writer's. */
+        std::mutex _direct_mutex{};
+
+        std::mutex _sleep_mutex{};
+        std::condition_variable _wake{};
+
+        basic_log_writer() = default;
+
+    public:
+        basic_log_writer(const basic_log_writer &) = delete;
+        basic_log_writer &operator=(const basic_log_writer &) = delete;
+
+        ~basic_log_writer()
+        {
+            this->stop();
+        }
+
+        static basic_log_writer &instance()
+        {
+            static basic_log_writer writer;
+            return writer;
+        }
+
+        /* To set up before `start()`. */
+        Sink &sink()
+        {
+            return this->_sink;
+        }
+
+        /* Start writing records to `fd` from a background thread. */
+        void start(int fd = STDERR_FILENO)
+        {
+            std::lock_guard<std::mutex> lock(this->_start_mutex);
+            if (this->_running.load())
+            {
+                return;
+            }
+
+            this->_fd = fd;
+            this->_running.store(true);
+            this->_thread = std::thread{&basic_log_writer::run, this};
+        }
+
+        /**
+         * @brief       - Write out what is queued and join the writer.
+         *                Records written from now on are written
+         *                synchronously. Every record queued by a `write()`
+         *                that saw the writer running is written before
+         *                `stop()` returns.
+         */
+        void stop()
+        {
+            std::lock_guard<std::mutex> lock(this->_start_mutex);
+            if (!this->_running.exchange(false))
+            {
+                return;
+            }
+
+            this->wake();
+            this->_thread.join();
+
+            /* Callers that saw the writer running may still be appending:
+             * wait for them, then write what they queued. */
+            std::vector<std::shared_ptr<log_ring>> const rings = this->rings();
+            for (const auto &ring : rings)
+            {
+                while (ring->appending())
+                {
+                    std::this_thread::yield();
+                }
+            }
+
+            this->drain(rings);
+        }
+
+        bool running() const
+        {
+            return this->_running.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief       - Queue the record `first` + `second` on the calling
+         *                thread's ring. Waits for the writer while the ring
+         *                is full, and writes a record larger than the ring
+         *                directly, as well as any record once the writer
+         *                stopped.
+         */
+        void write(std::string_view first, std::string_view second = {})
+        {
+            log_ring &ring = this->local_ring();
+            if (first.size() + second.size() > ring.capacity())
+            {
+                this->flush();
+                this->write_direct(first, second);
+                return;
+            }
+
+            /* Pairs with `stop()`: either it waits for this append and
+             * drains it, or the writer is seen stopped here. */
+            ring.begin_append();
+            std::size_t used = 0;
+            while (this->_running.load(std::memory_order_seq_cst)
+                   && (used = ring.try_append(first, second)) == 0)
+            {
+                this->wake();
+                std::this_thread::yield();
+            }
+
+            ring.end_append();
+            if (!used)
+            {
+                this->write_direct(first, second);
+                return;
+            }
+
+            if (used > ring.capacity() / 2
+                && this->_sleeping.load(std::memory_order_relaxed))
+            {
+                this->wake();
+            }
+        }
+
+        /* Block until every record queued so far has been written. */
+        void flush()
+        {
+            for (;;)
+            {
+                bool empty = true;
+                for (const auto &ring : this->rings())
+                {
+                    empty = empty && ring->empty();
+                }
+
+                if (empty || !this->running())
+                {
+                    return;
+                }
+
+                this->wake();
+                std::this_thread::yield();
+            }
+        }
+
+    private:
+        log_ring &local_ring()
+        {
+            static thread_local ring_handle handle;
+            if (!handle.ring)
+            {
+                handle.ring = std::make_shared<log_ring>();
+                std::lock_guard<std::mutex> lock(this->_rings_mutex);
+                this->_rings.push_back(handle.ring);
+                this->_generation.fetch_add(1, std::memory_order_release);
+            }
+
+            return *handle.ring;
+        }
+
+        void write_direct(std::string_view first, std::string_view second)
+        {
+            iovec parts[2] = {{const_cast<char *>(first.data()), first.size()},
+                              {const_cast<char *>(second.data()), second.size()}};
+            std::lock_guard<std::mutex> lock(this->_direct_mutex);
+            this->_sink.write(this->_fd, parts, second.empty() ? 1 : 2);
+        }
+
+        std::vector<std::shared_ptr<log_ring>> rings()
+        {
+            std::lock_guard<std::mutex> lock(this->_rings_mutex);
+            return this->_rings;
+        }
+
+        void wake()
+        {
+            std::lock_guard<std::mutex> lock(this->_sleep_mutex);
+            this->_wake.notify_one();
+        }
+
+        void run()
+        {
+            std::vector<std::shared_ptr<log_ring>> rings;
+            unsigned generation = ~0u;
+            for (;;)
+            {
+                unsigned const now =
+                    this->_generation.load(std::memory_order_acquire);
+                if (now != generation)
+                {
+                    generation = now;
+                    rings = this->rings();
+                }
+
+                if (this->drain(rings))
+                {
+                    continue;
+                }
+
+                if (!this->running())
+                {
+                    return;
+                }
+
+                this->drop_retired(rings);
+
+                std::unique_lock<std::mutex> lock(this->_sleep_mutex);
+                this->_sleeping.store(true, std::memory_order_relaxed);
+                this->_wake.wait_for(lock, poll_interval);
+                this->_sleeping.store(false, std::memory_order_relaxed);
+            }
+        }
+
+        /* One call of the sink over every ring, or a few if there are many.
+         * Returns the bytes written. */
+        std::size_t drain(const std::vector<std::shared_ptr<log_ring>> &rings)
+        {
+            std::size_t written = 0;
+            std::size_t next = 0;
+            while (next < rings.size())
+            {
+                iovec iov[max_iovecs];
+                std::size_t sizes[max_iovecs / 2] = {};
+                std::size_t count = 0;
+                std::size_t const first = next;
+                for (; next < rings.size() && count + 2 <= max_iovecs
+                       && next - first < max_iovecs / 2;
+                     next++)
+                {
+                    std::size_t const n = rings[next]->readable(iov + count);
+                    for (std::size_t i = 0; i < n; i++)
+                    {
+                        sizes[next - first] += iov[count + i].iov_len;
+                    }
+
+                    count += n;
+                }
+
+                if (count)
+                {
+                    std::lock_guard<std::mutex> lock(this->_direct_mutex);
+                    this->_sink.write(this->_fd, iov, count);
+                }
+
+                for (std::size_t i = first; i < next; i++)
+                {
+                    if (sizes[i - first])
+                    {
+                        rings[i]->release(sizes[i - first]);
+                        written += sizes[i - first];
+                    }
+                }
+            }
+
+            return written;
+        }
+
+        void drop_retired(std::vector<std::shared_ptr<log_ring>> &rings)
+        {
+            std::lock_guard<std::mutex> lock(this->_rings_mutex);
+            for (std::size_t i = 0; i < this->_rings.size();)
+            {
+                if (this->_rings[i]->retired() && this->_rings[i]->empty())
+                {
+                    this->_rings[i] = this->_rings.back();
+                    this->_rings.pop_back();
+                    this->_generation.fetch_add(1, std::memory_order_release);
+                }
+                else
+                {
+                    i++;
+                }
+            }
+
+            rings = this->_rings;
+        }
+    };
+
+    typedef basic_log_writer<text_sink> log_writer;
+}
@@ -1,96 +1,364 @@
 #pragma once
 #include <assert.h>
-#include <string>
-#include <iostream>
-#include <sstream>
+#include <atomic>
+#include <string_view>
+
+#include "binary_log.hh"
+#include "callsite.hh"
+#include "log_buffer.hh"
+#include "log_format.hh"
+#include "log_writer.hh"
+
+/* Statements below this level, as a number from 0 (debug) to 4 (fatal), are
+ * compiled out. Fatal ones are always kept. */
+#ifndef LARVA_LOG_MIN_LEVEL
+#define LARVA_LOG_MIN_LEVEL 0
+#endif
 
 namespace larva
 {
     class logger
     {
     public:
-        enum class level
+        typedef larva::log_level level;
+        typedef larva::binary_sink::output output;
+
+        /* Takes the `<<` operands of a statement compiled out, see
+         * `LARVA_LOG_DISCARDED`. */
+        struct discarded
         {
-            debug = 0,
-            info,
-            warn,
-            error,
-            fatal
+            template <typename T>
+            const discarded &operator<<(const T &) const
+            {
+                return *this;
+            }
+        };
+
+        /* Turns a logging expression into `void`, see `LARVA_LOG`. */
+        struct voidify
+        {
+            void operator&(const logger &)
+            {
+            }
+
+            void operator&(const discarded &)
+            {
+            }
         };
 
     private:
-        std::ostringstream _str;
+        static inline std::atomic<logger::level> _threshold{
+            logger::level::debug};
+
+        /* The text of the line, or its record in deferred mode. */
+        log_buffer _line{};
+        bool _deferred{false};
+        const callsite *_site{nullptr};
         logger::level _level;
 
     public:
+        /**
+         * @brief       - Used by the level macros. In deferred mode the line
+         *                is recorded as the callsite id and the raw bytes of
+         *                its arguments, otherwise it is formatted here.
+         */
+        explicit logger(const callsite &site) : _site{&site},
+                                                _level{site.level}
+        {
+            if (larva::binary_log_writer::instance().running())
+            {
+                this->_deferred = true;
+                binary_log::begin(this->_line, site.id, binary_log::now_ns());
+            }
+            else
+            {
+                this->begin_text(site.file, site.line, site.function);
+            }
+        }
+
+        /* Without a registered callsite, the line is always formatted here. */
         logger(logger::level level,
                const char *file,
                int line,
                const char *function) : _level{level}
         {
-            this->_str << "[" << level_to_string(level) << "] "
-                       << file << ":" << line << " " << function << "(): ";
+            this->begin_text(file, line, function);
         }
 
         ~logger()
         {
-            std::cerr << std::boolalpha << this->_str.str() << std::endl;
+            if (this->_deferred)
+            {
+                this->write_record();
+            }
+            else
+            {
+                this->write_text(this->_line.view());
+            }
+
             if (this->_level == logger::level::fatal)
             {
                 abort();
             }
         }
 
+        /**
+         * @brief       - Whether a statement of `level` is logged. Checked by
+         *                the level macros before a logger is built, so a
+         *                disabled statement costs one relaxed load and does
+         *                not evaluate its arguments. With a literal level, the
+         *                compile-time part folds away.
+         */
+        static bool enabled(logger::level level)
+        {
+            return level == logger::level::fatal
+                   || (static_cast<int>(level) >= LARVA_LOG_MIN_LEVEL
+                       && level >= _threshold.load(std::memory_order_relaxed));
+        }
+
+        /* Only log from `level` up, within what was compiled in. */
+        static void set_level(logger::level level)
+        {
+            _threshold.store(level, std::memory_order_relaxed);
+        }
+
+        static logger::level threshold()
+        {
+            return _threshold.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief       - From now on, lines are queued per thread and written
+         *                to `fd` by a background thread. A fatal line waits
+         *                until everything before it is written.
+         */
+        static void start_async(int fd = STDERR_FILENO)
+        {
+            larva::log_writer::instance().start(fd);
+        }
+
+        /* Write out what is queued and go back to synchronous writes. */
+        static void stop_async()
+        {
+            larva::log_writer::instance().stop();
+        }
+
+        /**
+         * @brief       - Like `start_async()`, but callers only queue the
+         *                callsite id and the raw bytes of the arguments. The
+         *                background thread formats them, or with
+         *                `output::binary` writes them as they are, to be
+         *                turned into text by `log_decode`.
+         */
+        static void start_deferred(int fd = STDERR_FILENO,
+                                   logger::output output = logger::output::text)
+        {
+            larva::binary_log_writer &writer =
+                larva::binary_log_writer::instance();
+            if (!writer.running())
+            {
+                writer.sink().set_output(output);
+                writer.start(fd);
+            }
+        }
+
+        static void stop_deferred()
+        {
+            larva::binary_log_writer::instance().stop();
+        }
+
         template <typename T>
-        logger &operator<<(T data)
+        logger &operator<<(const T &data)
+        {
+            if (this->_deferred)
+            {
+                binary_log::encode(this->_line, data);
+            }
+            else
+            {
+                larva::format_to(this->_line, data);
+            }
+
+            return *this;
+        }
+
+        /**
+         * @brief       - Append `args` in the place of each `{}` of
+         *                `format`, which `LARVA_LOG_FORMAT` parsed at
+         *                compile time. In deferred mode only the arguments
+         *                are recorded, the text stays with the callsite.
+         */
+        template <std::size_t N, typename... Args>
+        logger &print(const log_format<N> &format, const Args &...args)
         {
-            this->_str << data;
+            if (this->_deferred)
+            {
+                (binary_log::encode(this->_line, args), ...);
+                return *this;
+            }
+
+            std::size_t next = 0;
+            auto literals = [&]() {
+                for (; next < N && !format.segments[next].argument; next++)
+                {
+                    this->_line.append(format.segments[next].text);
+                }
+            };
+
+            literals();
+            ((larva::format_to(this->_line, args), next++, literals()), ...);
             return *this;
         }
 
     private:
-        std::string level_to_string(logger::level level)
+        void begin_text(const char *file, int line, const char *function)
+        {
+            binary_log::format_header(this->_level, file,
+                                      static_cast<std::uint32_t>(line),
+                                      function, this->_line);
+        }
+
+        void write_text(std::string_view line)
         {
-            switch (level)
+            larva::log_writer &writer = larva::log_writer::instance();
+            if (writer.running())
             {
-            case logger::level::debug:
-                return "DEBUG";
-            case logger::level::info:
-                return "INFO";
-            case logger::level::warn:
-                return "WARN";
-            case logger::level::error:
-                return "ERROR";
-            case logger::level::fatal:
-                return "FATAL";
+                writer.write(line, "\n");
+                if (this->_level == logger::level::fatal)
+                {
+                    writer.flush();
+                }
             }
+            else
+            {
+                iovec parts[2] = {{const_cast<char *>(line.data()), line.size()},
+                                  {const_cast<char *>("\n"), 1}};
+                larva::write_all(STDERR_FILENO, parts, 2);
+            }
+        }
+
+        void write_record()
+        {
+            std::string_view const record = binary_log::finish(this->_line);
+            larva::binary_log_writer &writer =
+                larva::binary_log_writer::instance();
+            if (writer.running())
+            {
+                writer.write(record);
+                if (this->_level == logger::level::fatal)
+                {
+                    writer.flush();
+                }
 
-            return "";
+                return;
+            }
+
+            /* The writer stopped since the constructor. */
+            log_buffer line;
+            binary_log::format_header(this->_level, this->_site->file,
+                                      this->_site->line, this->_site->function,
+                                      line);
+            binary_log::reader r(record.data() + binary_log::header_size,
+                                 record.size() - binary_log::header_size);
+            binary_log::format_arguments(r, *this->_site, line);
+            this->write_text(line.view());
         }
     };
 }
 
-#define debug() larva::logger(larva::logger::level::debug, \
-                              __FILE__,                    \
-                              __LINE__,                    \
-                              __func__)
-
-#define info() larva::logger(larva::logger::level::info, \
-                             __FILE__,                   \
-                             __LINE__,                   \
-                             __func__)
-
-#define warn() larva::logger(larva::logger::level::warn, \
-                             __FILE__,                   \
-                             __LINE__,                   \
-                             __func__)
-
-#define error() larva::logger(larva::logger::level::error, \
-                              __FILE__,                    \
-                              __LINE__,                    \
-                              __func__)
-
-#define fatal() larva::logger(larva::logger::level::fatal, \
-                              __FILE__,                    \
-                              __LINE__,                    \
-                              __func__)
\ No newline at end of file
+/* A logger for `level` if it is enabled. Otherwise nothing is built and the
+ * `<<` operands are not evaluated: they are the right operand of `&`, in the
+ * branch not taken. */
+#define LARVA_LOG(level)                         \
+    !larva::logger::enabled(level)               \
+        ? (void)0                                \
+        : larva::logger::voidify() &             \
+              larva::logger(LARVA_CALLSITE(level))
+
+/* A statement below `LARVA_LOG_MIN_LEVEL`. The `<<` operands are still
+ * checked by the compiler, but the branch is never taken and names no logger
+ * or callsite, so nothing is emitted for it, whatever the optimization. */
+#define LARVA_LOG_DISCARDED                      \
+    true ? (void)0                               \
+         : larva::logger::voidify() & larva::logger::discarded()
+
+#if LARVA_LOG_MIN_LEVEL > 0
+#define debug() LARVA_LOG_DISCARDED
+#else
+#define debug() LARVA_LOG(larva::logger::level::debug)
+#endif
+
+#if LARVA_LOG_MIN_LEVEL > 1
+#define info() LARVA_LOG_DISCARDED
+#else
+#define info() LARVA_LOG(larva::logger::level::info)
+#endif
+
+#if LARVA_LOG_MIN_LEVEL > 2
+#define warn() LARVA_LOG_DISCARDED
+#else
+#define warn() LARVA_LOG(larva::logger::level::warn)
+#endif
+
+#if LARVA_LOG_MIN_LEVEL > 3
+#define error() LARVA_LOG_DISCARDED
+#else
+#define error() LARVA_LOG(larva::logger::level::error)
+#endif
+
+#define fatal() LARVA_LOG(larva::logger::level::fatal)
+
+/**
+ * A formatted statement: `LARVA_LOG_FORMAT(level, "user {} took {} ms", id,
+ * ms)`. The format, a string literal, is parsed at compile time and checked
+ * against the number of arguments; it is stored once, in the callsite.
+ * Filtered like `LARVA_LOG`.
+ */
+#define LARVA_LOG_FORMAT(level, format, ...)                                 \
+    (!larva::logger::enabled(level)                                          \
+         ? (void)0                                                           \
+         : [](const char *function, const auto &...args) {                   \
+               static constexpr larva::log_format<                          \
+                   larva::parse_format(format)> parsed{format};             \
+               static_assert(parsed.arity == sizeof...(args),               \
+                             "the log format needs one {} per argument");   \
+               static const larva::callsite site{level, __FILE__, __LINE__, \
+                                                 function, parsed};         \
+               larva::logger(site).print(parsed, args...);                  \
+           }(__func__, ##__VA_ARGS__))
+
+/* A formatted statement below `LARVA_LOG_MIN_LEVEL`: the format is still
+ * checked, nothing else is kept, as with `LARVA_LOG_DISCARDED`. */
+#define LARVA_LOG_FORMAT_DISCARDED(format, ...)                              \
+    (true ? (void)0                                                          \
+          : [](const auto &...args) {                                        \
+                static_assert(larva::log_format<larva::parse_format(format)>{ \
+                                  format}.arity == sizeof...(args),          \
+                              "the log format needs one {} per argument");   \
+            }(__VA_ARGS__))
+
+#if LARVA_LOG_MIN_LEVEL > 0
+#define log_debug(...) LARVA_LOG_FORMAT_DISCARDED(__VA_ARGS__)
+#else
+#define log_debug(...) LARVA_LOG_FORMAT(larva::logger::level::debug, __VA_ARGS__)
+#endif
+
+#if LARVA_LOG_MIN_LEVEL > 1
+#define log_info(...) LARVA_LOG_FORMAT_DISCARDED(__VA_ARGS__)
+#else
+#define log_info(...) LARVA_LOG_FORMAT(larva::logger::level::info, __VA_ARGS__)
+#endif
+
+#if LARVA_LOG_MIN_LEVEL > 2
+#define log_warn(...) LARVA_LOG_FORMAT_DISCARDED(__VA_ARGS__)
+#else
+#define log_warn(...) LARVA_LOG_FORMAT(larva::logger::level::warn, __VA_ARGS__)
+#endif
+
+#if LARVA_LOG_MIN_LEVEL > 3
+#define log_error(...) LARVA_LOG_FORMAT_DISCARDED(__VA_ARGS__)
+#else
+#define log_error(...) LARVA_LOG_FORMAT(larva::logger::level::error, __VA_ARGS__)
+#endif
+
+#define log_fatal(...) LARVA_LOG_FORMAT(larva::logger::level::fatal, __VA_ARGS__)
@@ -0,0 +1,176 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <clock.hh>
+#include <pool_config.hh>
+
+namespace larva {
+
+    namespace autotune_detail {
+
+        constexpr unsigned rounds = 5;
+        constexpr unsigned ping_pongs = 2000;
+        constexpr unsigned fan_out = 64;
+        constexpr unsigned fan_out_leaves = 64;
+
+        /* Round trips from outside the pool, which pay for waking a worker
+         * up: spinning longer makes them cheaper. */
+        template <typename Pool>
+        std::int64_t ping_pong(Pool &pool)
+        {
+            std::int64_t const start = larva::now_ns();
+            unsigned ball = 0;
+            for (unsigned i = 0; i < ping_pongs; i++) {
+                ball = pool.submit([ball]() { return ball + 1; }).get();
+            }
+
+            return larva::now_ns() - start;
+        }
+
+        /* A task fanning out small tasks and waiting for them, twice
+         * nested, which pays for queueing, stealing and parking. */
+        template <typename Pool>
+        std::int64_t fan(Pool &pool)
+        {
+            std::atomic<unsigned> leaves {0};
+            std::int64_t const start = larva::now_ns();
+            auto root = pool.submit([&pool, &leaves]() {
+                std::vector<std::future<void>> children;
+                for (unsigned i = 0; i < fan_out; i++) {
+                    children.push_back(pool.submit([&pool, &leaves]() {
+                        std::vector<std::future<void>> grandchildren;
+                        for (unsigned j = 0; j < fan_out_leaves; j++) {
+                            grandchildren.push_back(pool.submit([&leaves]() {
+                                leaves.fetch_add(
+                                    1, std::memory_order_relaxed);
+                            }));
+                        }
+
+                        for (auto &g: grandchildren) {
+                            while (g.wait_for(std::chrono::seconds(0))
+                                   != std::future_status::ready)
+                            {
+                                pool.run_pending_task();
+                            }
+                        }
+                    }));
+                }
+
+                for (auto &c: children) {
+                    while (c.wait_for(std::chrono::seconds(0))
+                           != std::future_status::ready)
+                    {
+                        pool.run_pending_task();
+                    }
+                }
+            });
+            root.get();
+            return larva::now_ns() - start;
+        }
+
+        struct score {
+            std::int64_t ping_pong {0};
+            std::int64_t fan {0};
+        };
+
+        /* Best of a few rounds of each workload on a fresh pool. */
+        template <typename Pool>
+        score measure(const pool_config &config)
+        {
+            Pool pool(config);
+            score best {INT64_MAX, INT64_MAX};
+            ping_pong(pool);
+            fan(pool);
+            for (unsigned i = 0; i < rounds; i++) {
+                best.ping_pong = std::min(best.ping_pong, ping_pong(pool));
+                best.fan = std::min(best.fan, fan(pool));
+            }
+
+            return best;
+        }
+    }
+
+    /**
+     * @brief       - Pick the pool parameters for this host from short runs
+     *                of two workloads, a ping-pong from outside the pool and
+     *                a nested fan-out. Each candidate is scored by its times
+     *                relative to the defaults, so both weigh the same. The
+     *                worker count is tuned first, 1, 2, 4... up to
+     *                `max_threads`, then the spin count at that count. Takes
+     *                in the order of a second; `log` gets a line per
+     *                candidate.
+     */
+    template <typename Pool>
+    pool_config calibrate(unsigned max_threads =
+                              std::thread::hardware_concurrency(),
+                          std::ostream *log = nullptr)
+    {
+        using autotune_detail::measure;
+        using autotune_detail::score;
+
+        pool_config best;
+        best.threads = std::max(1u, max_threads);
+        score const base = measure<Pool>(best);
+        double best_cost = 2;
+
+        auto const trial = [&](const pool_config &candidate) {
+            score const s = measure<Pool>(candidate);
+            double const cost =
+                static_cast<double>(s.ping_pong) / base.ping_pong
+                + static_cast<double>(s.fan) / base.fan;
+            if (log) {
+                *log << "threads " << candidate.threads << ", spin_count "
+                     << candidate.spin_count << ": ping-pong "
+                     << s.ping_pong / autotune_detail::ping_pongs
+                     << " ns, fan-out " << s.fan / 1000 << " us, cost "
+                     << cost << "\n";
+            }
+
+            if (cost < best_cost) {
+                best_cost = cost;
+                best = candidate;
+            }
+        };
+
+        for (unsigned n = 1; n < max_threads; n *= 2) {
+            pool_config c = best;
+            c.threads = n;
+            trial(c);
+        }
+
+        for (unsigned spins: {0u, 16u, 256u, 1024u}) {
+            pool_config c = best;
+            c.spin_count = spins;
+            trial(c);
+        }
+
+        return best;
+    }
+
+    /**
+     * @brief       - The parameters saved at `path` for this host, or,
+     *                failing that, freshly calibrated ones, which are saved
+     *                there for the next start. For instance:
+     *                `stealing_thread_pool pool(
+     *                     tuned_config<stealing_thread_pool>("pool.conf"));`
+     */
+    template <typename Pool>
+    pool_config tuned_config(const std::string &path)
+    {
+        pool_config config;
+        if (!config.load(path)) {
+            config = calibrate<Pool>();
+            config.save(path);
+        }
+
+        return config;
+    }
+}
@@ -0,0 +1,930 @@
+#pragma once
+#include <atomic>
+#include <future>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+#include <thread>
+
+#include <threadsafe_container/queue.hh>
+#include <joiner_thread.hh>
+#include <pool_config.hh>
+#include <pool_policies.hh>
+#include <pool_state.hh>
+#include <pool_stats.hh>
+#include <label_usage.hh>
+#include <latency_histogram.hh>
+#include <perf_counters.hh>
+#include <promise_task.hh>
+#include <quiescence.hh>
+#include <scratch_arena.hh>
+#include <task_label.hh>
+#include <task_slab.hh>
+#include <task_trace.hh>
+#include <f_wrapper.hh>
+
+namespace larva {
+
+    enum class shutdown_mode {
+        drain,
+        now
+    };
+
+    /**
+     * @brief       - Thread pool composed from compile-time policies:
+     *                - QueuePolicy: the queue owned by each worker.
+     *                - IdlePolicy: what a worker does when there is no work.
+     *                - StealPolicy: which queues an idle worker steals from.
+     *                - TaskType: the type-erased task stored in the queues.
+     *                  It must be constructible from a callable, optionally
+     *                  with `std::allocator_arg` and a memory resource.
+     *                Every policy call is resolved statically, so the worker
+     *                loop is inlined into a single function.
+     */
+    template <typename QueuePolicy,
+              typename IdlePolicy,
+              typename StealPolicy,
+              typename TaskType = larva::f_wrapper>
+    class basic_pool {
+    public:
+        typedef TaskType task_type;
+
+        static constexpr std::size_t default_trace_capacity = 1 << 16;
+
+    private:
+        /* What the queues hold: the task, the epoch it was counted in, when
+         * latencies are recorded, when it was submitted, when tracing, its id
+         * and the id of the task that submitted it, and its label. */
+        struct job {
+            TaskType task {};
+            unsigned epoch {0};
+            std::int64_t submitted_ns {0};
+            std::uint64_t id {0};
+            std::uint64_t parent {0};
+            std::uint16_t label {0};
+        };
+
+        typedef typename QueuePolicy::template queue<job> local_queue_type;
+
+        /* Everything a worker owns, kept on its own cache lines. The slab is
+         * declared first so it outlives the tasks queued from it. */
+        struct alignas(64) worker {
+            larva::task_slab slab {};
+            larva::scratch_arena arena {};
+            local_queue_type queue {};
+            larva::worker_counters counters {};
+            larva::latency_histogram queue_wait {};
+            larva::latency_histogram execution {};
+
+            /* Hardware counters, opened by the worker itself, and what they
+             * counted per label. `perf_inline` totals the tasks run inside
+             * the current one, which are not charged to it. */
+            larva::perf_counters perf {};
+            std::atomic<unsigned> perf_events {0};
+            larva::perf_table perf_by_label {};
+            larva::perf_sample perf_inline {};
+            larva::usage_table usage {};
+
+            /* Label and start of the task running on the worker, published
+             * while tasks are watched; `task_since` is zero between tasks.
+             * It is also zeroed while both change, so `inspect()` can tell
+             * a label that goes with the start time it read. */
+            std::atomic<std::uint16_t> task_label {0};
+            std::atomic<std::int64_t> task_since {0};
+
+            void publish_task(std::uint16_t label, std::int64_t since)
+            {
+                this->task_since.store(0, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                this->task_label.store(label, std::memory_order_relaxed);
+                this->task_since.store(since, std::memory_order_release);
+            }
+        };
+
+        std::atomic_bool _done {false};
+        std::atomic_bool _closing {false};
+        larva::threadsafe_queue<job> _work_queue {};
+        std::vector<std::unique_ptr<worker>> _workers {};
+        IdlePolicy _idle {};
+
+        /* Tasks in flight, one shard per worker and a last one shared by
+         * every other thread. */
+        larva::quiescence _quiescence;
+        larva::worker_counters _external_counters {};
+        larva::latency_histogram _external_queue_wait {};
+        larva::latency_histogram _external_execution {};
+        std::atomic_bool _record_latency {false};
+        std::atomic_bool _record_perf {false};
+        std::atomic_bool _record_usage {false};
+        std::atomic<unsigned> _watch_tasks {0};
+        larva::usage_table _external_usage {};
+
+        /* Created by the first `start_tracing()` and kept until the pool is
+         * destroyed, since queued tasks may still refer to it. */
+        std::unique_ptr<larva::task_trace> _trace {};
+        std::atomic<larva::task_trace *> _tracing {nullptr};
+        mutable std::mutex _trace_mutex {};
+        std::mutex _shutdown_mutex {};
+
+        /* Threads are declared after everything they use, so the joiner is
+         * destroyed, and the threads joined, before the queues go away. */
+        std::vector<std::thread> _worker_threads {};
+        larva::join_threads _joiner {_worker_threads};
+
+        static thread_local basic_pool *_owner;
+        static thread_local worker *_self;
+        static thread_local unsigned _index;
+
+        /* The pool, epoch and trace id of the task running on this thread,
+         * if any. */
+        static thread_local basic_pool *_running;
+        static thread_local unsigned _running_epoch;
+        static thread_local std::uint64_t _running_task;
+
+        /* Usage of the tasks run inline by the task running on this thread,
+         * which is not charged to it. */
+        static thread_local larva::label_usage _usage_inline;
+
+    public:
+        basic_pool(): basic_pool(std::thread::hardware_concurrency()) {}
+
+        explicit basic_pool(unsigned thread_number):
+            basic_pool(larva::pool_config {thread_number})
+        {}
+
+        explicit basic_pool(const larva::pool_config &config):
+            _quiescence {config.threads + 1}
+        {
+            this->_idle.configure(config);
+            try {
+                for (unsigned i = 0; i < config.threads; ++i)
+                {
+                    this->_workers.push_back(std::make_unique<worker>());
+                }
+
+                for (unsigned i = 0; i < config.threads; ++i)
+                {
+                    this->_worker_threads.push_back(
+                        std::thread{&basic_pool::worker_thread, this, i});
+                }
+            } catch (...) {
+                this->_done = true;
+                this->_idle.notify_all();
+                throw;
+            }
+        }
+
+        ~basic_pool()
+        {
+            this->shutdown(shutdown_mode::drain);
+        }
+
+        basic_pool(const basic_pool&) = delete;
+        basic_pool& operator=(const basic_pool&) = delete;
+
+        template <typename FunctionType>
+        std::future<typename std::result_of<FunctionType()>::type>
+        submit(FunctionType f)
+        {
+            typedef typename std::result_of<FunctionType()>::type result_type;
+            larva::promise_task<FunctionType, result_type> task(std::move(f));
+            std::future<result_type> res(task.get_future());
+
+            /* Workers of this pool carve the task from their own slab, any
+             * other thread allocates it from the heap. */
+            if (this->_owner == this) {
+                this->push(TaskType(std::allocator_arg,
+                                    &this->_self->slab,
+                                    std::move(task)));
+            } else {
+                this->push(TaskType(std::move(task)));
+            }
+
+            return res;
+        }
+
+        /**
+         * @brief       - Same as `submit(f)`, with what the task costs counted
+         *                under `label`.
+         */
+        template <typename FunctionType>
+        std::future<typename std::result_of<FunctionType()>::type>
+        submit(larva::task_label label, FunctionType f)
+        {
+            typedef typename std::result_of<FunctionType()>::type result_type;
+            larva::promise_task<FunctionType, result_type> task(std::move(f));
+            std::future<result_type> res(task.get_future());
+
+            if (this->_owner == this) {
+                this->push(TaskType(std::allocator_arg,
+                                    &this->_self->slab,
+                                    std::move(task)),
+                           label.id());
+            } else {
+                this->push(TaskType(std::move(task)), label.id());
+            }
+
+            return res;
+        }
+
+        /**
+         * @brief       - Same as `submit(f)`, but the task and the shared state
+         *                of the future are allocated from `resource`. A worker
+         *                gives them back after the future is ready, and the
+         *                shared state is freed by its last owner, often the
+         *                returned future. So `resource` must be thread-safe,
+         *                e.g. a `synchronized_pool_resource`, and outlive the
+         *                returned future as well as the pool, or at least a
+         *                `wait_idle()` or `barrier()` called after this
+         *                submit.
+         */
+        template <typename FunctionType>
+        std::future<typename std::result_of<FunctionType()>::type>
+        submit(std::pmr::memory_resource *resource, FunctionType f)
+        {
+            typedef typename std::result_of<FunctionType()>::type result_type;
+            larva::promise_task<FunctionType, result_type> task(
+                std::allocator_arg, resource, std::move(f));
+            std::future<result_type> res(task.get_future());
+
+            this->push(TaskType(std::allocator_arg, resource, std::move(task)));
+            return res;
+        }
+
+        /**
+         * @brief       - Run one pending task if there is any, yield otherwise.
+         *                Meant for tasks and other threads waiting on a future,
+         *                so it never parks the caller.
+         */
+        void run_pending_task()
+        {
+            if (!this->try_run_pending_task()) {
+                std::this_thread::yield();
+            }
+        }
+
+        /**
+         * @brief       - Block until every submitted task has finished,
+         *                including the tasks they submitted. Must not be
+         *                called from a task of this pool, which would wait for
+         *                itself.
+         */
+        void wait_idle()
+        {
+            this->_quiescence.wait_idle();
+        }
+
+        /**
+         * @brief       - Block until every task submitted before the call, and
+         *                every task they submit, has finished. Unlike
+         *                `wait_idle()`, work submitted from outside meanwhile
+         *                belongs to the next epoch and does not hold the
+         *                caller. Must not be called from a task of this pool.
+         */
+        void barrier()
+        {
+            this->_quiescence.barrier();
+        }
+
+        /**
+         * @brief       - Stop the pool and join its workers. Afterwards,
+         *                `submit()` throws `std::runtime_error`.
+         *                - drain: refuse new work from outside the pool, run
+         *                  every queued task and whatever they submit, then
+         *                  stop.
+         *                - now: let running tasks finish and stop. Queued
+         *                  tasks are dropped and their futures report
+         *                  `broken_promise`.
+         *                Parked workers are woken immediately. Calling it
+         *                again has no effect. The destructor drains.
+         */
+        void shutdown(shutdown_mode mode = shutdown_mode::drain)
+        {
+            std::lock_guard<std::mutex> lock(this->_shutdown_mutex);
+            if (this->_done && this->_worker_threads.empty()) {
+                return;
+            }
+
+            this->_closing = true;
+            if (mode == shutdown_mode::drain) {
+                this->wait_idle();
+            }
+
+            this->_done = true;
+            this->_idle.notify_all();
+            for (auto &thread: this->_worker_threads) {
+                if (thread.joinable()) {
+                    thread.join();
+                }
+            }
+
+            this->_worker_threads.clear();
+            this->drop_pending_tasks();
+        }
+
+        unsigned size() const
+        {
+            return static_cast<unsigned>(this->_workers.size());
+        }
+
+        /**
+         * @brief       - Read the counters of every worker, without stopping
+         *                them. Each counter is exact, but they are not read at
+         *                the same instant.
+         */
+        larva::pool_stats stats() const
+        {
+            larva::pool_stats s;
+            s.workers.reserve(this->_workers.size());
+            for (auto &w: this->_workers) {
+                s.workers.push_back(w->counters.load());
+            }
+
+            s.external = this->_external_counters.load();
+            return s;
+        }
+
+        /**
+         * @brief       - Start or stop timing tasks. While stopped, tasks are
+         *                not timestamped at all.
+         */
+        void record_latency(bool enabled)
+        {
+            this->_record_latency.store(enabled, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief       - Merge the histograms of every worker, in nanoseconds:
+         *                - queue_wait: from `submit()` to the task leaving
+         *                  its queue.
+         *                - execution: from then to the task returning.
+         */
+        larva::pool_latency latency() const
+        {
+            larva::pool_latency l;
+            for (auto &w: this->_workers) {
+                l.queue_wait += w->queue_wait.snapshot();
+                l.execution += w->execution.snapshot();
+            }
+
+            l.queue_wait += this->_external_queue_wait.snapshot();
+            l.execution += this->_external_execution.snapshot();
+            return l;
+        }
+
+        /**
+         * @brief       - Start or stop charging each task's CPU time, wall
+         *                time and count to its label. Reading the thread CPU
+         *                clock is a system call, so this is off by default.
+         */
+        void record_usage(bool enabled)
+        {
+            this->_record_usage.store(enabled, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief       - Merge the usage tables of every worker and of other
+         *                threads, indexed by `task_label::id()`. A task run
+         *                inside another, while waiting, is charged to its own
+         *                label only.
+         */
+        std::vector<larva::label_usage> usage() const
+        {
+            std::vector<larva::label_usage> u;
+            for (auto &w: this->_workers) {
+                w->usage.merge_into(u);
+            }
+
+            this->_external_usage.merge_into(u);
+            return u;
+        }
+
+        /**
+         * @brief       - Start or stop publishing the label and start time of
+         *                the task each worker runs, for `inspect()` and the
+         *                watchdog. Costs a clock read and a few stores per
+         *                task. Calls nest: tasks are watched until every
+         *                `watch_tasks(true)` is matched by a
+         *                `watch_tasks(false)`, so watchdogs and other users
+         *                of `inspect()` do not turn it off for each other.
+         */
+        void watch_tasks(bool enabled)
+        {
+            if (enabled) {
+                this->_watch_tasks.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            unsigned watchers =
+                this->_watch_tasks.load(std::memory_order_relaxed);
+            while (watchers && !this->_watch_tasks.compare_exchange_weak(
+                       watchers, watchers - 1, std::memory_order_relaxed)) {
+            }
+        }
+
+        /**
+         * @brief       - Snapshot the queue depths, the shared backlog, which
+         *                workers are idle and, while tasks are watched, what
+         *                each worker runs and for how long.
+         */
+        larva::pool_state inspect() const
+        {
+            larva::pool_state s;
+            s.taken_ns = larva::now_ns();
+            s.backlog = this->_work_queue.size();
+            for (auto &w: this->_workers) {
+                larva::worker_state ws;
+                ws.queue_depth = w->queue.size();
+
+                std::int64_t const idle_since =
+                    w->counters.idle_since.load(std::memory_order_relaxed);
+                if (idle_since && idle_since < s.taken_ns) {
+                    ws.idle = true;
+                    ws.idle_ns = static_cast<std::uint64_t>(s.taken_ns
+                                                            - idle_since);
+                }
+
+                /* The label is read between two reads of the start time,
+                 * and kept only if the task did not change meanwhile. */
+                std::int64_t const since =
+                    w->task_since.load(std::memory_order_acquire);
+                std::uint16_t const label =
+                    w->task_label.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (since && since < s.taken_ns
+                    && w->task_since.load(std::memory_order_relaxed) == since) {
+                    ws.running = true;
+                    ws.label = label;
+                    ws.task_since_ns = since;
+                    ws.running_ns = static_cast<std::uint64_t>(
+                        s.taken_ns - since);
+                }
+
+                s.workers.push_back(ws);
+            }
+
+            return s;
+        }
+
+        /**
+         * @brief       - Start or stop counting cycles, instructions, LLC
+         *                misses, context switches and migrations of the tasks
+         *                run by workers. Each worker opens its counters the
+         *                first time it runs a task while counting; where
+         *                `perf_event_open` is refused, tasks run uncounted.
+         */
+        void record_perf(bool enabled)
+        {
+            this->_record_perf.store(enabled, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief       - What the counters saw, per worker and per label. A
+         *                task run inside another, while waiting, is charged
+         *                to its own label only.
+         */
+        larva::perf_report perf() const
+        {
+            larva::perf_report r;
+            unsigned const labels = larva::task_label::count();
+            r.labels.resize(labels);
+            for (auto &w: this->_workers) {
+                larva::perf_sample sum;
+                for (unsigned l = 0; l < labels; l++) {
+                    larva::perf_sample const s = w->perf_by_label.load(l);
+                    r.labels[l] += s;
+                    sum += s;
+                }
+
+                r.workers.push_back(sum);
+                r.events |= w->perf_events.load(std::memory_order_relaxed);
+            }
+
+            return r;
+        }
+
+        /**
+         * @brief       - Start recording submits, task starts and ends,
+         *                steals and parks in a ring of `events_per_thread`
+         *                events per worker, plus one shared by the other
+         *                threads. Full rings overwrite their oldest events.
+         *                The rings are allocated by the first call only; later
+         *                calls resume tracing in them.
+         */
+        void start_tracing(std::size_t events_per_thread =
+                               default_trace_capacity)
+        {
+            std::lock_guard<std::mutex> lock(this->_trace_mutex);
+            if (!this->_trace) {
+                this->_trace = std::make_unique<larva::task_trace>(
+                    this->size(), events_per_thread);
+            }
+
+            this->_tracing.store(this->_trace.get(), std::memory_order_release);
+        }
+
+        /**
+         * @brief       - Stop recording. Tasks submitted while tracing still
+         *                record their start and end.
+         */
+        void stop_tracing()
+        {
+            this->_tracing.store(nullptr, std::memory_order_release);
+        }
+
+        /**
+         * @brief       - Copy the recorded events, oldest first. Lane `i` is
+         *                worker `i`, lane `size()` every other thread.
+         */
+        std::vector<larva::trace_event> trace_events() const
+        {
+            std::lock_guard<std::mutex> lock(this->_trace_mutex);
+            if (!this->_trace) {
+                return {};
+            }
+
+            return this->_trace->collect();
+        }
+
+        /**
+         * @brief       - Write the recorded events as a Chrome trace, to open
+         *                in chrome://tracing or ui.perfetto.dev.
+         */
+        void write_trace(std::ostream &os) const
+        {
+            larva::write_chrome_trace(os, this->trace_events(), this->size());
+        }
+
+    private:
+        void worker_thread(unsigned index)
+        {
+            this->_owner = this;
+            this->_index = index;
+            this->_self = this->_workers[index].get();
+            this->_self->slab.bind_to_current_thread();
+            larva::this_task::detail::arena = &this->_self->arena;
+
+            larva::worker_counters &counters = this->_self->counters;
+            while (!this->_done) {
+                if (this->try_run_pending_task()) {
+                    continue;
+                }
+
+                larva::task_trace *const trace =
+                    this->_tracing.load(std::memory_order_acquire);
+                std::int64_t const idle_since = trace ? larva::now_ns() : 0;
+                counters.begin_idle();
+                bool const parked = this->_idle.wait([this]() -> bool {
+                    return this->has_work();
+                });
+                counters.end_idle(parked);
+                if (parked && trace) {
+                    trace->record(index, larva::trace_event_type::park, 0, 0,
+                                  idle_since);
+                    trace->record(index, larva::trace_event_type::unpark, 0);
+                }
+            }
+
+            this->_owner = nullptr;
+            this->_self = nullptr;
+            larva::this_task::detail::arena = nullptr;
+        }
+
+        void push(TaskType &&task, std::uint16_t label = 0)
+        {
+            /* Count the task before checking the flags, so that a draining
+             * `shutdown()` either refuses it or waits for it. A task submitted
+             * by a task joins its epoch. */
+            bool const local = this->_owner == this;
+            unsigned const shard = this->shard_index();
+            job j {std::move(task), 0, 0, 0, 0, label};
+            if (this->_record_latency.load(std::memory_order_relaxed)) {
+                j.submitted_ns = larva::now_ns();
+            }
+
+            if (this->_running == this) {
+                j.epoch = this->_running_epoch;
+                this->_quiescence.enter(shard, j.epoch);
+            } else {
+                j.epoch = this->_quiescence.enter(shard);
+            }
+
+            if (this->_done || (this->_closing && !local)) {
+                this->_quiescence.leave(shard, j.epoch);
+                throw std::runtime_error("larva::basic_pool: submit after "
+                                         "shutdown");
+            }
+
+            larva::task_trace *const trace =
+                this->_tracing.load(std::memory_order_acquire);
+            if (trace) {
+                j.id = trace->new_id(shard);
+                j.parent = this->_running == this ? this->_running_task : 0;
+                trace->record(shard, larva::trace_event_type::submit,
+                              j.id, j.parent);
+            }
+
+            /* Workers of this pool push on their own queue, any other thread
+             * pushes on the shared queue. */
+            if (local) {
+                this->_self->queue.push(std::move(j));
+                if constexpr (StealPolicy::can_steal) {
+                    this->_idle.notify_one();
+                }
+            } else {
+                this->_work_queue.push(std::move(j));
+                this->_idle.notify_one();
+            }
+        }
+
+        unsigned shard_index() const
+        {
+            return this->_owner == this ? this->_index : this->size();
+        }
+
+        bool try_run_pending_task()
+        {
+            unsigned epoch;
+            {
+                job j;
+                if (!this->pop_task_from_local_queue(j)
+                    && !this->pop_task_from_pool_queue(j)
+                    && !this->pop_task_from_other_thread_queue(j))
+                {
+                    return false;
+                }
+
+                epoch = j.epoch;
+                if (j.submitted_ns) {
+                    this->execute_timed(j);
+                } else {
+                    this->execute(j);
+                }
+            }
+
+            /* The task, and everything it captured, is gone, and everything
+             * recorded about it is stored, before it is reported as
+             * finished: `stats()` after `wait_idle()` or `barrier()` is
+             * exact. */
+            this->count(&larva::worker_counters::tasks_executed);
+            this->_quiescence.leave(this->shard_index(), epoch);
+            return true;
+        }
+
+        /* Workers bump their own counters, other threads share theirs. */
+        void count(std::atomic<std::uint64_t> larva::worker_counters::*field)
+        {
+            if (this->_owner == this) {
+                larva::worker_counters::bump(this->_self->counters.*field);
+            } else {
+                larva::worker_counters::add(this->_external_counters.*field);
+            }
+        }
+
+        void execute(job &j)
+        {
+            basic_pool *const running = this->_running;
+            unsigned const running_epoch = this->_running_epoch;
+            std::uint64_t const running_task = this->_running_task;
+            this->_running = this;
+            this->_running_epoch = j.epoch;
+            this->_running_task = j.id;
+
+            /* The trace outlives the pool's tasks, so a traced task records
+             * its end even if tracing stopped meanwhile. */
+            larva::task_trace *const trace = j.id ? this->_trace.get() : nullptr;
+            if (trace) {
+                trace->record(this->shard_index(),
+                              larva::trace_event_type::task_begin,
+                              j.id, j.parent);
+            }
+
+            /* A task run inline shows until it returns, then the outer one
+             * shows again. */
+            worker *const watched =
+                this->_owner == this
+                && this->_watch_tasks.load(std::memory_order_relaxed)
+                    ? this->_self : nullptr;
+            std::uint16_t outer_label = 0;
+            std::int64_t outer_since = 0;
+            if (watched) {
+                outer_label = watched->task_label.load(std::memory_order_relaxed);
+                outer_since = watched->task_since.load(std::memory_order_relaxed);
+                watched->publish_task(j.label, larva::now_ns());
+            }
+
+            if (this->_record_usage.load(std::memory_order_relaxed)) {
+                this->execute_accounted(j);
+            } else {
+                this->run(j);
+            }
+
+            if (watched) {
+                watched->publish_task(outer_label, outer_since);
+            }
+
+            if (trace) {
+                trace->record(this->shard_index(),
+                              larva::trace_event_type::task_end,
+                              j.id, j.parent);
+            }
+
+            this->_running = running;
+            this->_running_epoch = running_epoch;
+            this->_running_task = running_task;
+        }
+
+        void run(job &j)
+        {
+            if (this->_owner != this) {
+                j.task();
+                return;
+            }
+
+            /* Whatever the task put in the scratch arena is dropped when it
+             * returns. Marking instead of resetting keeps the arena of an
+             * outer task intact when a task waits by running other tasks. */
+            larva::scratch_arena::scope scratch(this->_self->arena);
+            if (this->_record_perf.load(std::memory_order_relaxed)) {
+                this->execute_counted(j);
+            } else {
+                j.task();
+            }
+        }
+
+        void execute_accounted(job &j)
+        {
+            std::int64_t const wall = larva::now_ns();
+            std::int64_t const cpu = larva::thread_cpu_ns();
+            larva::label_usage const inner = this->_usage_inline;
+            this->run(j);
+
+            larva::label_usage const total {
+                0,
+                static_cast<std::uint64_t>(larva::thread_cpu_ns() - cpu),
+                static_cast<std::uint64_t>(larva::now_ns() - wall)};
+            larva::label_usage own = total - (this->_usage_inline - inner);
+            own.tasks = 1;
+            if (this->_owner == this) {
+                this->_self->usage.add(j.label, own);
+            } else {
+                this->_external_usage.add_shared(j.label, own);
+            }
+
+            this->_usage_inline = inner + total;
+        }
+
+        void execute_counted(job &j)
+        {
+            worker &w = *this->_self;
+            larva::perf_sample before;
+            if (!w.perf.read(before)) {
+                j.task();
+                return;
+            }
+
+            w.perf_events.store(w.perf.events(), std::memory_order_relaxed);
+            larva::perf_sample const inner = w.perf_inline;
+            j.task();
+
+            larva::perf_sample after;
+            if (!w.perf.read(after)) {
+                return;
+            }
+
+            larva::perf_sample const total = after - before;
+            w.perf_by_label.add(j.label, total - (w.perf_inline - inner));
+            w.perf_inline = inner + total;
+        }
+
+        void execute_timed(job &j)
+        {
+            std::int64_t const start = larva::now_ns();
+            this->execute(j);
+            std::int64_t const end = larva::now_ns();
+
+            std::uint64_t const wait = start - j.submitted_ns;
+            std::uint64_t const run = end - start;
+            if (this->_owner == this) {
+                this->_self->queue_wait.record(wait);
+                this->_self->execution.record(run);
+            } else {
+                this->_external_queue_wait.record_shared(wait);
+                this->_external_execution.record_shared(run);
+            }
+        }
+
+        void drop_pending_tasks()
+        {
+            job j;
+            while (this->_work_queue.try_pop(j)) {
+                j.task = TaskType();
+                this->_quiescence.leave(this->size(), j.epoch);
+            }
+
+            for (auto &w: this->_workers) {
+                while (w->queue.try_pop(j)) {
+                    j.task = TaskType();
+                    this->_quiescence.leave(this->size(), j.epoch);
+                }
+            }
+        }
+
+        /* Checked by a worker about to park, so it only sleeps when there is
+         * really nothing it could run. */
+        bool has_work() const
+        {
+            if (this->_done || !this->_work_queue.empty()) {
+                return true;
+            }
+
+            if (!this->_self->queue.empty()) {
+                return true;
+            }
+
+            if constexpr (StealPolicy::can_steal) {
+                for (auto &w: this->_workers) {
+                    if (!w->queue.empty()) {
+                        return true;
+                    }
+                }
+            }
+
+            return false;
+        }
+
+        bool pop_task_from_local_queue(job &task)
+        {
+            if (this->_owner != this || !this->_self->queue.try_pop(task)) {
+                return false;
+            }
+
+            larva::worker_counters::bump(this->_self->counters.local_pops);
+            return true;
+        }
+
+        bool pop_task_from_pool_queue(job &task)
+        {
+            if (!this->_work_queue.try_pop(task)) {
+                return false;
+            }
+
+            this->count(&larva::worker_counters::global_pops);
+            return true;
+        }
+
+        bool pop_task_from_other_thread_queue(job &task)
+        {
+            if (this->_owner != this) {
+                return false;
+            }
+
+            return StealPolicy::steal(
+                this->_index,
+                this->size(),
+                [this, &task](auto victim) -> bool {
+                    larva::worker_counters &counters = this->_self->counters;
+                    if (this->_workers[victim]->queue.try_steal(task)) {
+                        larva::worker_counters::bump(counters.steals);
+                        if (task.id) {
+                            this->_trace->record(
+                                this->_index,
+                                larva::trace_event_type::steal,
+                                task.id, victim);
+                        }
+                        return true;
+                    }
+
+                    larva::worker_counters::bump(counters.failed_steals);
+                    return false;
+                });
+        }
+    };
+
+    template <typename Q, typename I, typename S, typename T>
+    thread_local basic_pool<Q, I, S, T>
+    *basic_pool<Q, I, S, T>::_owner {nullptr};
+
+    template <typename Q, typename I, typename S, typename T>
+    thread_local typename basic_pool<Q, I, S, T>::worker
+    *basic_pool<Q, I, S, T>::_self {nullptr};
+
+    template <typename Q, typename I, typename S, typename T>
+    thread_local unsigned basic_pool<Q, I, S, T>::_index {0};
+
+    template <typename Q, typename I, typename S, typename T>
+    thread_local basic_pool<Q, I, S, T>
+    *basic_pool<Q, I, S, T>::_running {nullptr};
+
+    template <typename Q, typename I, typename S, typename T>
+    thread_local unsigned basic_pool<Q, I, S, T>::_running_epoch {0};
+
+    template <typename Q, typename I, typename S, typename T>
+    thread_local std::uint64_t basic_pool<Q, I, S, T>::_running_task {0};
+
+    template <typename Q, typename I, typename S, typename T>
+    thread_local larva::label_usage basic_pool<Q, I, S, T>::_usage_inline {};
+}
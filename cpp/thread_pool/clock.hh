@@ -0,0 +1,36 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+#if defined(__unix__)
+#include <time.h>
+#endif
+
+namespace larva {
+
+    /**
+     * @brief       - Steady clock in nanoseconds, the time base of every
+     *                counter, histogram and trace of the pools.
+     */
+    inline std::int64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief       - CPU time consumed by the calling thread, in nanoseconds.
+     *                Unlike `now_ns()` this is a system call on Linux, so it
+     *                is only read when asked for. Zero where not supported.
+     */
+    inline std::int64_t thread_cpu_ns()
+    {
+#if defined(__unix__) && defined(CLOCK_THREAD_CPUTIME_ID)
+        timespec ts;
+        if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+            return std::int64_t {ts.tv_sec} * 1000000000 + ts.tv_nsec;
+        }
+#endif
+        return 0;
+    }
+}
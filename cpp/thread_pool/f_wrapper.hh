@@ -2,12 +2,15 @@
 
 #include <future>
 #include <memory>
+#include <memory_resource>
+#include <type_traits>
 
 namespace larva {
 
     class f_wrapper {
         struct impl_base {
             virtual void call() = 0;
+            virtual void destroy() = 0;
             virtual ~impl_base() {}
         };
 
@@ -16,13 +19,62 @@ namespace larva {
             F _f;
             impl(F&& f): _f {std::move(f)} {}
             void call() { this->_f(); }
+            void destroy() { delete this; }
         };
 
-        std::unique_ptr<impl_base> _impl {nullptr};
+        /* Same as `impl`, but the object lives in a memory resource and
+         * gives itself back to it. */
+        template <typename F>
+        struct resource_impl: impl_base {
+            F _f;
+            std::pmr::memory_resource *_resource;
+            resource_impl(F&& f, std::pmr::memory_resource *resource):
+                _f {std::move(f)}, _resource {resource} {}
+            void call() { this->_f(); }
+            void destroy()
+            {
+                std::pmr::memory_resource *resource = this->_resource;
+                this->~resource_impl();
+                resource->deallocate(this,
+                                     sizeof(resource_impl),
+                                     alignof(resource_impl));
+            }
+        };
+
+        struct deleter {
+            void operator()(impl_base *p) const { p->destroy(); }
+        };
+
+        std::unique_ptr<impl_base, deleter> _impl {nullptr};
+
+        template <typename F>
+        static impl_base *make(std::pmr::memory_resource *resource, F&& f)
+        {
+            typedef resource_impl<F> impl_type;
+            void *p = resource->allocate(sizeof(impl_type),
+                                         alignof(impl_type));
+            try {
+                return new (p) impl_type(std::move(f), resource);
+            } catch (...) {
+                resource->deallocate(p, sizeof(impl_type), alignof(impl_type));
+                throw;
+            }
+        }
 
     public:
         template <typename F>
-        f_wrapper(F&& f): _impl {std::make_unique<impl<F>>(std::move(f))} {}
+        f_wrapper(F&& f): _impl {new impl<std::decay_t<F>>(std::move(f))} {}
+
+        /**
+         * @brief       - Allocate the wrapped callable from `resource`, which
+         *                must outlive the wrapper.
+         */
+        template <typename F>
+        f_wrapper(std::allocator_arg_t,
+                  std::pmr::memory_resource *resource,
+                  F&& f):
+            _impl {make<std::decay_t<F>>(resource, std::move(f))} {}
+
         f_wrapper(f_wrapper&& other): _impl {std::move(other._impl)} {}
         f_wrapper() = default;
 
@@ -34,6 +86,7 @@ namespace larva {
         f_wrapper& operator=(f_wrapper&& other)
         {
             this->_impl = std::move(other._impl);
+            return *this;
         }
 
         f_wrapper(const f_wrapper&) = delete;
@@ -41,4 +94,4 @@ namespace larva {
         f_wrapper& operator=(const f_wrapper&) = delete;
     };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace larva {
+
+    /**
+     * @brief       - Sleep while `word` still holds `expected`. May return
+     *                spuriously, so callers re-check their condition. Where
+     *                futexes are not available this only yields.
+     */
+    inline void futex_wait(std::atomic<std::uint32_t> &word,
+                           std::uint32_t expected)
+    {
+#if defined(__linux__)
+        static_assert(sizeof(word) == sizeof(std::uint32_t),
+                      "futex word must be 32 bits");
+        syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word),
+                FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+        if (word.load() == expected) {
+            std::this_thread::yield();
+        }
+#endif
+    }
+
+    /**
+     * @brief       - Wake every thread sleeping on `word`.
+     */
+    inline void futex_wake_all(std::atomic<std::uint32_t> &word)
+    {
+#if defined(__linux__)
+        syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word),
+                FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+#else
+        (void)word;
+#endif
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <task_label.hh>
+
+namespace larva {
+
+    /**
+     * @brief       - What the tasks of one label cost: how many ran, the CPU
+     *                time of their threads and the wall time they took.
+     */
+    struct label_usage {
+        std::uint64_t tasks {0};
+        std::uint64_t cpu_ns {0};
+        std::uint64_t wall_ns {0};
+
+        label_usage &operator+=(const label_usage &other)
+        {
+            this->tasks += other.tasks;
+            this->cpu_ns += other.cpu_ns;
+            this->wall_ns += other.wall_ns;
+            return *this;
+        }
+
+        label_usage &operator-=(const label_usage &other)
+        {
+            this->tasks -= other.tasks;
+            this->cpu_ns -= other.cpu_ns;
+            this->wall_ns -= other.wall_ns;
+            return *this;
+        }
+
+        friend label_usage operator+(label_usage a, const label_usage &b)
+        {
+            return a += b;
+        }
+
+        friend label_usage operator-(label_usage a, const label_usage &b)
+        {
+            return a -= b;
+        }
+    };
+
+    /**
+     * @brief       - Per-label usage, indexed by `task_label::id()`. Workers
+     *                write their own table with plain loads and stores, other
+     *                threads share one with atomic adds, and readers merge
+     *                them at any time.
+     */
+    class usage_table {
+        struct entry {
+            std::atomic<std::uint64_t> tasks {0};
+            std::atomic<std::uint64_t> cpu_ns {0};
+            std::atomic<std::uint64_t> wall_ns {0};
+        };
+
+        entry _entries[task_label::capacity] {};
+
+        static void bump(std::atomic<std::uint64_t> &v, std::uint64_t n)
+        {
+            v.store(v.load(std::memory_order_relaxed) + n,
+                    std::memory_order_relaxed);
+        }
+
+    public:
+        void add(unsigned label, const label_usage &u)
+        {
+            entry &e = this->_entries[label];
+            bump(e.tasks, u.tasks);
+            bump(e.cpu_ns, u.cpu_ns);
+            bump(e.wall_ns, u.wall_ns);
+        }
+
+        void add_shared(unsigned label, const label_usage &u)
+        {
+            entry &e = this->_entries[label];
+            e.tasks.fetch_add(u.tasks, std::memory_order_relaxed);
+            e.cpu_ns.fetch_add(u.cpu_ns, std::memory_order_relaxed);
+            e.wall_ns.fetch_add(u.wall_ns, std::memory_order_relaxed);
+        }
+
+        /* Add every label to `out`, which grows to the labels known. */
+        void merge_into(std::vector<label_usage> &out) const
+        {
+            unsigned const labels = task_label::count();
+            if (out.size() < labels) {
+                out.resize(labels);
+            }
+
+            for (unsigned l = 0; l < labels; l++) {
+                const entry &e = this->_entries[l];
+                out[l] += label_usage {
+                    e.tasks.load(std::memory_order_relaxed),
+                    e.cpu_ns.load(std::memory_order_relaxed),
+                    e.wall_ns.load(std::memory_order_relaxed)};
+            }
+        }
+    };
+}
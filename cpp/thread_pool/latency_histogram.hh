@@ -0,0 +1,214 @@
+#pragma once
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace larva {
+
+    /**
+     * @brief       - Plain copy of a histogram, to merge and query.
+     */
+    class histogram_snapshot {
+    public:
+        /* Values below `sub_count` get a bucket each. Above, every power of
+         * two is split in `sub_count` buckets, so a bucket is never wider
+         * than 1/32 of its values. */
+        static constexpr unsigned sub_bits = 5;
+        static constexpr unsigned sub_count = 1u << sub_bits;
+        static constexpr unsigned bucket_count = (65 - sub_bits) * sub_count;
+
+    private:
+        std::vector<std::uint64_t> _counts;
+        std::uint64_t _total {0};
+        std::uint64_t _sum {0};
+        std::uint64_t _max {0};
+
+    public:
+        histogram_snapshot(): _counts(bucket_count, 0) {}
+
+        static unsigned index_of(std::uint64_t value)
+        {
+            if (value < sub_count) {
+                return static_cast<unsigned>(value);
+            }
+
+            unsigned const msb = 63 - __builtin_clzll(value);
+            unsigned const shift = msb - sub_bits;
+            unsigned const mantissa = static_cast<unsigned>(value >> shift);
+            return (shift + 1) * sub_count + (mantissa - sub_count);
+        }
+
+        /* Highest value that lands in bucket `index`. */
+        static std::uint64_t upper_bound_of(unsigned index)
+        {
+            if (index < sub_count) {
+                return index;
+            }
+
+            unsigned const shift = index / sub_count - 1;
+            std::uint64_t const mantissa = index % sub_count + sub_count;
+            return ((mantissa + 1) << shift) - 1;
+        }
+
+        void add(unsigned index, std::uint64_t count)
+        {
+            this->_counts[index] += count;
+            this->_total += count;
+        }
+
+        void add_totals(std::uint64_t sum, std::uint64_t max)
+        {
+            this->_sum += sum;
+            if (max > this->_max) {
+                this->_max = max;
+            }
+        }
+
+        histogram_snapshot &operator+=(const histogram_snapshot &other)
+        {
+            for (unsigned i = 0; i < bucket_count; i++) {
+                this->_counts[i] += other._counts[i];
+            }
+
+            this->_total += other._total;
+            this->add_totals(other._sum, other._max);
+            return *this;
+        }
+
+        std::uint64_t count() const
+        {
+            return this->_total;
+        }
+
+        /* Values that landed in bucket `index`. */
+        std::uint64_t count_at(unsigned index) const
+        {
+            return this->_counts[index];
+        }
+
+        std::uint64_t max() const
+        {
+            return this->_max;
+        }
+
+        double mean() const
+        {
+            return this->_total
+                    ? static_cast<double>(this->_sum) / this->_total
+                    : 0.0;
+        }
+
+        /**
+         * @brief       - Smallest bucket bound under which at least `q` of
+         *                the values fall, `q` in [0, 1]. Never above `max()`.
+         */
+        std::uint64_t percentile(double q) const
+        {
+            if (this->_total == 0) {
+                return 0;
+            }
+
+            /* The rank of the q-th value, rounded up, so p50 of 3 values
+             * is the 2nd. The slack keeps 0.07 * 100 at rank 7. */
+            double const total = static_cast<double>(this->_total);
+            double const rank_q = std::ceil(q * total - 1e-9);
+            std::uint64_t const rank =
+                rank_q < 1 ? 1
+                : rank_q >= total ? this->_total
+                : static_cast<std::uint64_t>(rank_q);
+
+            std::uint64_t seen = 0;
+            for (unsigned i = 0; i < bucket_count; i++) {
+                seen += this->_counts[i];
+                if (seen >= rank) {
+                    std::uint64_t const bound = upper_bound_of(i);
+                    return bound < this->_max ? bound : this->_max;
+                }
+            }
+
+            return this->_max;
+        }
+    };
+
+    /**
+     * @brief       - Summary to export.
+     */
+    struct latency_summary {
+        std::uint64_t count {0};
+        double mean {0};
+        std::uint64_t p50 {0};
+        std::uint64_t p99 {0};
+        std::uint64_t p999 {0};
+        std::uint64_t max {0};
+
+        static latency_summary of(const histogram_snapshot &h)
+        {
+            return {h.count(), h.mean(), h.percentile(0.50),
+                    h.percentile(0.99), h.percentile(0.999), h.max()};
+        }
+    };
+
+    /**
+     * @brief       - Queue wait and execution time of the tasks of a pool.
+     */
+    struct pool_latency {
+        histogram_snapshot queue_wait {};
+        histogram_snapshot execution {};
+    };
+
+    /**
+     * @brief       - Log-linear (HDR style) histogram of non-negative values,
+     *                updated without locks. `record()` is for a single writer
+     *                and uses plain loads and stores, `record_shared()` is for
+     *                several writers. Readers take a `snapshot()` at any time.
+     */
+    class latency_histogram {
+        std::atomic<std::uint64_t> _counts[histogram_snapshot::bucket_count] {};
+        std::atomic<std::uint64_t> _sum {0};
+        std::atomic<std::uint64_t> _max {0};
+
+    public:
+        void record(std::uint64_t value)
+        {
+            std::atomic<std::uint64_t> &c =
+                this->_counts[histogram_snapshot::index_of(value)];
+            c.store(c.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+            this->_sum.store(this->_sum.load(std::memory_order_relaxed) + value,
+                             std::memory_order_relaxed);
+            if (value > this->_max.load(std::memory_order_relaxed)) {
+                this->_max.store(value, std::memory_order_relaxed);
+            }
+        }
+
+        void record_shared(std::uint64_t value)
+        {
+            this->_counts[histogram_snapshot::index_of(value)].fetch_add(
+                1, std::memory_order_relaxed);
+            this->_sum.fetch_add(value, std::memory_order_relaxed);
+
+            std::uint64_t max = this->_max.load(std::memory_order_relaxed);
+            while (value > max
+                   && !this->_max.compare_exchange_weak(
+                            max, value, std::memory_order_relaxed))
+            {}
+        }
+
+        histogram_snapshot snapshot() const
+        {
+            histogram_snapshot s;
+            for (unsigned i = 0; i < histogram_snapshot::bucket_count; i++) {
+                std::uint64_t const n =
+                    this->_counts[i].load(std::memory_order_relaxed);
+                if (n) {
+                    s.add(i, n);
+                }
+            }
+
+            s.add_totals(this->_sum.load(std::memory_order_relaxed),
+                         this->_max.load(std::memory_order_relaxed));
+            return s;
+        }
+    };
+}
@@ -0,0 +1,385 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <threadsafe_container/queue.hh>
+#include <threadsafe_container/spsc_ring.hh>
+#include <joiner_thread.hh>
+#include <promise_task.hh>
+#include <quiescence.hh>
+#include <scratch_arena.hh>
+#include <task_slab.hh>
+#include <f_wrapper.hh>
+#include <futex.hh>
+
+namespace larva {
+
+    /**
+     * @brief       - Shared-nothing executor with one worker pinned per core.
+     *                Nothing is stolen: a task runs on the core it was sent
+     *                to, with that core's run queue, task slab and scratch
+     *                arena.
+     *                - A core sending work to another core uses the SPSC ring
+     *                  dedicated to that pair, out of an N x N mesh.
+     *                - Other threads go through a locked inbox per core,
+     *                  taking the cores in turn.
+     *                - Each worker pins itself, then allocates its core and
+     *                  the rings it reads from, so that first touch places
+     *                  them on the memory node of that core.
+     *                - A core polls its rings in batches and only sleeps,
+     *                  on a futex, after finding all of them empty.
+     */
+    class per_core_executor {
+    public:
+        static constexpr std::size_t default_ring_capacity = 1024;
+        static constexpr std::size_t batch_size = 32;
+        static constexpr unsigned spin_count = 64;
+
+    private:
+        struct alignas(64) core {
+            larva::task_slab slab {};
+            larva::scratch_arena arena {};
+            std::deque<larva::f_wrapper> run_queue {};
+            larva::threadsafe_queue<larva::f_wrapper> inbox {};
+            std::atomic<std::uint32_t> doorbell {0};
+            std::atomic_bool sleeping {false};
+        };
+
+        std::atomic_bool _done {false};
+        unsigned _count;
+        std::atomic<unsigned> _next_core {0};
+        std::vector<std::unique_ptr<core>> _cores {};
+
+        /* `_rings[from * _count + to]` carries work from core `from` to core
+         * `to`. */
+        std::vector<std::unique_ptr<larva::spsc_ring<larva::f_wrapper>>>
+            _rings {};
+        larva::quiescence _quiescence;
+
+        std::vector<std::thread> _worker_threads {};
+        larva::join_threads _joiner {_worker_threads};
+
+        inline static thread_local per_core_executor *_owner {nullptr};
+        inline static thread_local unsigned _index {0};
+
+    public:
+        explicit per_core_executor(
+            unsigned core_number = std::thread::hardware_concurrency(),
+            std::size_t ring_capacity = default_ring_capacity):
+            _count {core_number}, _quiescence {core_number + 1}
+        {
+            this->_cores.resize(core_number);
+            this->_rings.resize(std::size_t {core_number} * core_number);
+            /* Each worker reports when its core is set up, or why it could
+             * not be. */
+            std::vector<std::future<void>> ready;
+            try {
+                std::vector<int> const cpus = allowed_cpus();
+                for (unsigned i = 0; i < core_number; ++i)
+                {
+                    std::promise<void> started;
+                    ready.push_back(started.get_future());
+                    this->_worker_threads.push_back(
+                        std::thread{&per_core_executor::worker_thread, this,
+                                    i, cpus.empty() ? -1 : cpus[i % cpus.size()],
+                                    ring_capacity, std::move(started)});
+                }
+
+                for (std::future<void> &r: ready) {
+                    r.get();
+                }
+            } catch (...) {
+                /* Let the other workers finish setting up first. */
+                for (std::future<void> &r: ready) {
+                    if (r.valid()) {
+                        r.wait();
+                    }
+                }
+
+                this->stop();
+                throw;
+            }
+        }
+
+        /**
+         * @brief       - Run every task already sent, and whatever they send,
+         *                then stop the cores.
+         */
+        ~per_core_executor()
+        {
+            this->_quiescence.wait_idle();
+            this->stop();
+        }
+
+        per_core_executor(const per_core_executor&) = delete;
+        per_core_executor& operator=(const per_core_executor&) = delete;
+
+        unsigned size() const
+        {
+            return this->_count;
+        }
+
+        /**
+         * @brief       - Index of the core running the caller, or -1 when the
+         *                caller is not one of the cores of this executor.
+         */
+        int current_core() const
+        {
+            return this->_owner == this ? static_cast<int>(this->_index) : -1;
+        }
+
+        /**
+         * @brief       - Run `f` on core `target`. From a core, the task goes
+         *                through the ring from this core to `target`; if the
+         *                ring is full, the caller keeps running its own work
+         *                until there is room.
+         */
+        template <typename FunctionType>
+        std::future<typename std::result_of<FunctionType()>::type>
+        submit_to(unsigned target, FunctionType f)
+        {
+            typedef typename std::result_of<FunctionType()>::type result_type;
+            if (target >= this->_count) {
+                throw std::out_of_range("larva::per_core_executor: no such "
+                                        "core");
+            }
+
+            larva::promise_task<FunctionType, result_type> task(std::move(f));
+            std::future<result_type> res(task.get_future());
+
+            if (this->_owner != this) {
+                this->_quiescence.enter(this->_count, 0);
+                this->_cores[target]->inbox.push(
+                    larva::f_wrapper(std::move(task)));
+                this->ring_doorbell(target);
+                return res;
+            }
+
+            core &self = *this->_cores[this->_index];
+            larva::f_wrapper wrapped(std::allocator_arg,
+                                     &self.slab,
+                                     std::move(task));
+            this->_quiescence.enter(this->_index, 0);
+            if (target == this->_index) {
+                self.run_queue.push_back(std::move(wrapped));
+                return res;
+            }
+
+            auto &ring = *this->_rings[this->_index * this->_count + target];
+            while (!ring.try_push(std::move(wrapped))) {
+                this->ring_doorbell(target);
+                if (!this->poll(self)) {
+                    std::this_thread::yield();
+                }
+            }
+
+            this->ring_doorbell(target);
+            return res;
+        }
+
+        /**
+         * @brief       - Run `f` on the calling core. From another thread, on
+         *                each core in turn.
+         */
+        template <typename FunctionType>
+        std::future<typename std::result_of<FunctionType()>::type>
+        submit(FunctionType f)
+        {
+            int const here = this->current_core();
+            unsigned const target =
+                here >= 0 ? static_cast<unsigned>(here)
+                          : this->_next_core.fetch_add(
+                                1, std::memory_order_relaxed) % this->_count;
+            return this->submit_to(target, std::move(f));
+        }
+
+    private:
+        void worker_thread(unsigned index,
+                           int cpu,
+                           std::size_t ring_capacity,
+                           std::promise<void> started)
+        {
+            try {
+                if (cpu >= 0) {
+                    pin(cpu);
+                }
+
+                this->_cores[index] = std::make_unique<core>();
+                for (unsigned from = 0; from < this->_count; from++) {
+                    this->_rings[from * this->_count + index] =
+                        std::make_unique<larva::spsc_ring<larva::f_wrapper>>(
+                            ring_capacity);
+                }
+            } catch (...) {
+                started.set_exception(std::current_exception());
+                return;
+            }
+
+            started.set_value();
+            this->_owner = this;
+            this->_index = index;
+            core &self = *this->_cores[index];
+            self.slab.bind_to_current_thread();
+            larva::this_task::detail::arena = &self.arena;
+
+            unsigned idle = 0;
+            while (true) {
+                if (this->poll(self)) {
+                    idle = 0;
+                    continue;
+                }
+
+                if (this->_done) {
+                    break;
+                }
+
+                if (++idle < spin_count) {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                this->park(self);
+                idle = 0;
+            }
+
+            this->_owner = nullptr;
+            larva::this_task::detail::arena = nullptr;
+        }
+
+        /* Move a batch from every incoming ring and the inbox to the run
+         * queue, then run a batch of it. Returns whether anything ran. */
+        bool poll(core &self)
+        {
+            auto const enqueue = [&self](larva::f_wrapper &&task) {
+                self.run_queue.push_back(std::move(task));
+            };
+
+            for (unsigned from = 0; from < this->_count; from++) {
+                this->_rings[from * this->_count + this->_index]->consume(
+                    enqueue, batch_size);
+            }
+
+            larva::f_wrapper task;
+            for (std::size_t i = 0; i < batch_size; i++) {
+                if (!self.inbox.try_pop(task)) {
+                    break;
+                }
+
+                self.run_queue.push_back(std::move(task));
+            }
+
+            std::size_t ran = 0;
+            while (ran < batch_size && !self.run_queue.empty()) {
+                {
+                    larva::f_wrapper next = std::move(self.run_queue.front());
+                    self.run_queue.pop_front();
+                    larva::scratch_arena::scope scratch(self.arena);
+                    next();
+                }
+
+                this->_quiescence.leave(this->_index, 0);
+                ran++;
+            }
+
+            return ran > 0;
+        }
+
+        bool has_incoming(core &self) const
+        {
+            if (this->_done || !self.run_queue.empty() || !self.inbox.empty()) {
+                return true;
+            }
+
+            for (unsigned from = 0; from < this->_count; from++) {
+                if (!this->_rings[from * this->_count + this->_index]->empty()) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        void park(core &self)
+        {
+            std::uint32_t const seq = self.doorbell.load();
+            self.sleeping.store(true);
+            if (!this->has_incoming(self)) {
+                larva::futex_wait(self.doorbell, seq);
+            }
+
+            self.sleeping.store(false);
+        }
+
+        void ring_doorbell(unsigned target)
+        {
+            /* Pairs with `sleeping` in `park()`: either the core sees the
+             * task before sleeping, or we see it asleep. */
+            core &c = *this->_cores[target];
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (c.sleeping.load(std::memory_order_relaxed)) {
+                c.doorbell.fetch_add(1);
+                larva::futex_wake_all(c.doorbell);
+            }
+        }
+
+        void stop()
+        {
+            this->_done = true;
+            for (auto &c: this->_cores) {
+                /* Null for a worker that failed to set up. */
+                if (c) {
+                    c->doorbell.fetch_add(1);
+                    larva::futex_wake_all(c->doorbell);
+                }
+            }
+
+            for (auto &thread: this->_worker_threads) {
+                if (thread.joinable()) {
+                    thread.join();
+                }
+            }
+        }
+
+        static std::vector<int> allowed_cpus()
+        {
+            std::vector<int> cpus;
+#if defined(__linux__)
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+                for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                    if (CPU_ISSET(cpu, &set)) {
+                        cpus.push_back(cpu);
+                    }
+                }
+            }
+#endif
+            return cpus;
+        }
+
+        /* Pin the calling thread. Pinning is best effort: a core that can
+         * not be pinned still runs, it may only migrate. */
+        static void pin(int cpu)
+        {
+#if defined(__linux__)
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+            (void)cpu;
+#endif
+        }
+    };
+}
@@ -0,0 +1,261 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <task_label.hh>
+
+namespace larva {
+
+    /**
+     * @brief       - Hardware and scheduler counts over some stretch of a
+     *                thread. A counter the system could not open stays zero.
+     */
+    struct perf_sample {
+        std::uint64_t cycles {0};
+        std::uint64_t instructions {0};
+        std::uint64_t llc_misses {0};
+        std::uint64_t context_switches {0};
+        std::uint64_t migrations {0};
+
+        static constexpr unsigned field_count = 5;
+
+        std::uint64_t &operator[](unsigned i)
+        {
+            return at<std::uint64_t>(*this, i);
+        }
+
+        std::uint64_t operator[](unsigned i) const
+        {
+            return at<const std::uint64_t>(*this, i);
+        }
+
+        perf_sample &operator+=(const perf_sample &other)
+        {
+            for (unsigned i = 0; i < field_count; i++) {
+                (*this)[i] += other[i];
+            }
+
+            return *this;
+        }
+
+        perf_sample &operator-=(const perf_sample &other)
+        {
+            for (unsigned i = 0; i < field_count; i++) {
+                (*this)[i] -= other[i];
+            }
+
+            return *this;
+        }
+
+        friend perf_sample operator+(perf_sample a, const perf_sample &b)
+        {
+            return a += b;
+        }
+
+        friend perf_sample operator-(perf_sample a, const perf_sample &b)
+        {
+            return a -= b;
+        }
+
+    private:
+        template <typename Field, typename Self>
+        static Field &at(Self &self, unsigned i)
+        {
+            switch (i) {
+            case 0: return self.cycles;
+            case 1: return self.instructions;
+            case 2: return self.llc_misses;
+            case 3: return self.context_switches;
+            default: return self.migrations;
+            }
+        }
+    };
+
+    /**
+     * @brief       - Counters of the calling thread, opened with
+     *                `perf_event_open` as one group, so a sample is a single
+     *                `read()`. Events the kernel or the hardware refuses,
+     *                e.g. in a VM, are left out; if none opens, `read()`
+     *                fails and the caller just runs uncounted.
+     */
+    class perf_counters {
+        /* perf_sample field of each group member, in group order. */
+        unsigned _fields[perf_sample::field_count] {};
+        int _fds[perf_sample::field_count] {};
+        unsigned _open {0};
+        bool _tried {false};
+
+    public:
+        perf_counters() = default;
+        perf_counters(const perf_counters&) = delete;
+        perf_counters& operator=(const perf_counters&) = delete;
+
+        ~perf_counters()
+        {
+#if defined(__linux__)
+            for (unsigned i = 0; i < this->_open; i++) {
+                close(this->_fds[i]);
+            }
+#endif
+        }
+
+        /**
+         * @brief       - Open the counters on the first call, from the thread
+         *                to count. Returns whether any counter is open.
+         */
+        bool open()
+        {
+            if (this->_tried) {
+                return this->_open > 0;
+            }
+
+            this->_tried = true;
+#if defined(__linux__)
+            static constexpr std::uint32_t types[perf_sample::field_count] = {
+                PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                PERF_TYPE_SOFTWARE, PERF_TYPE_SOFTWARE};
+            static constexpr std::uint64_t configs[perf_sample::field_count] = {
+                PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_SW_CONTEXT_SWITCHES,
+                PERF_COUNT_SW_CPU_MIGRATIONS};
+
+            for (unsigned i = 0; i < perf_sample::field_count; i++) {
+                int const leader = this->_open ? this->_fds[0] : -1;
+                int const fd = open_event(types[i], configs[i], leader);
+                if (fd >= 0) {
+                    this->_fields[this->_open] = i;
+                    this->_fds[this->_open++] = fd;
+                }
+            }
+#endif
+            return this->_open > 0;
+        }
+
+        /* Which perf_sample fields are counted, as a bit mask. */
+        unsigned events() const
+        {
+            unsigned mask = 0;
+            for (unsigned i = 0; i < this->_open; i++) {
+                mask |= 1u << this->_fields[i];
+            }
+
+            return mask;
+        }
+
+        /**
+         * @brief       - Read the running totals of the calling thread,
+         *                opening the counters first if needed.
+         */
+        bool read(perf_sample &sample)
+        {
+            if (!this->open()) {
+                return false;
+            }
+
+#if defined(__linux__)
+            std::uint64_t values[1 + perf_sample::field_count];
+            ssize_t const size = (1 + this->_open) * sizeof(std::uint64_t);
+            if (::read(this->_fds[0], values, size) != size) {
+                return false;
+            }
+
+            for (unsigned i = 0; i < this->_open; i++) {
+                sample[this->_fields[i]] = values[1 + i];
+            }
+
+            return true;
+#else
+            (void)sample;
+            return false;
+#endif
+        }
+
+    private:
+#if defined(__linux__)
+        /* Scheduler events happen in the kernel, so count them there when
+         * allowed, and fall back to user space only otherwise. */
+        static int open_event(std::uint32_t type, std::uint64_t config,
+                              int leader)
+        {
+            for (int exclude_kernel: {0, 1}) {
+                perf_event_attr attr;
+                std::memset(&attr, 0, sizeof(attr));
+                attr.size = sizeof(attr);
+                attr.type = type;
+                attr.config = config;
+                attr.read_format = PERF_FORMAT_GROUP;
+                attr.exclude_kernel = exclude_kernel;
+                attr.exclude_hv = 1;
+
+                int const fd = static_cast<int>(
+                    syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+                if (fd >= 0) {
+                    return fd;
+                }
+            }
+
+            return -1;
+        }
+#endif
+    };
+
+    /**
+     * @brief       - Per-label totals of one worker. The worker is the only
+     *                writer and bumps them with plain loads and stores;
+     *                readers may load them at any time.
+     */
+    class perf_table {
+        std::atomic<std::uint64_t>
+            _values[task_label::capacity][perf_sample::field_count] {};
+
+    public:
+        void add(unsigned label, const perf_sample &sample)
+        {
+            for (unsigned i = 0; i < perf_sample::field_count; i++) {
+                std::atomic<std::uint64_t> &v = this->_values[label][i];
+                v.store(v.load(std::memory_order_relaxed) + sample[i],
+                        std::memory_order_relaxed);
+            }
+        }
+
+        perf_sample load(unsigned label) const
+        {
+            perf_sample s;
+            for (unsigned i = 0; i < perf_sample::field_count; i++) {
+                s[i] = this->_values[label][i].load(std::memory_order_relaxed);
+            }
+
+            return s;
+        }
+    };
+
+    /**
+     * @brief       - Counts of the tasks run by a pool's workers. `events`
+     *                tells which fields were counted on at least one worker;
+     *                `labels` is indexed by `task_label::id()`.
+     */
+    struct perf_report {
+        unsigned events {0};
+        std::vector<perf_sample> workers {};
+        std::vector<perf_sample> labels {};
+
+        perf_sample total() const
+        {
+            perf_sample sum;
+            for (const perf_sample &w: this->workers) {
+                sum += w;
+            }
+
+            return sum;
+        }
+    };
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <charconv>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#if defined(__unix__)
+#include <unistd.h>
+#endif
+
+namespace larva {
+
+    /**
+     * @brief       - Run-time parameters of a pool. Policies read what they
+     *                care about in `configure()` and ignore the rest.
+     *                - threads: number of workers.
+     *                - spin_count: how many times an idle worker yields
+     *                  before parking, for `park_idle_policy`.
+     */
+    struct pool_config {
+        static constexpr unsigned default_spin_count = 64;
+
+        unsigned threads {std::thread::hardware_concurrency()};
+        unsigned spin_count {default_spin_count};
+
+        static std::string host()
+        {
+#if defined(__unix__)
+            char name[256] = {};
+            if (gethostname(name, sizeof(name) - 1) == 0) {
+                return name;
+            }
+#endif
+            return "unknown";
+        }
+
+        /**
+         * @brief       - Write the parameters as `key = value` lines, with
+         *                the host they were tuned on.
+         */
+        bool save(const std::string &path) const
+        {
+            std::ofstream out(path);
+            out << "host = " << host() << "\n"
+                << "threads = " << this->threads << "\n"
+                << "spin_count = " << this->spin_count << "\n";
+            return static_cast<bool>(out);
+        }
+
+        /**
+         * @brief       - Read parameters written by `save()`. Fails, leaving
+         *                the config alone, if the file is missing, was tuned
+         *                on another host, lacks one of the keys `save()`
+         *                writes, or has a line other than a blank one or a
+         *                known `key = value` with a value in range. A
+         *                truncated or hand-broken file is refused rather
+         *                than loaded as defaults.
+         */
+        bool load(const std::string &path)
+        {
+            std::ifstream in(path);
+            if (!in) {
+                return false;
+            }
+
+            pool_config c = *this;
+            bool same_host = false;
+            bool has_threads = false;
+            bool has_spin_count = false;
+            std::string line;
+            while (std::getline(in, line)) {
+                std::istringstream fields(line);
+                std::string key, eq, value, extra;
+                if (!(fields >> key)) {
+                    continue;
+                }
+
+                if (!(fields >> eq >> value) || eq != "=" || fields >> extra) {
+                    return false;
+                }
+
+                if (key == "host") {
+                    same_host = value == host();
+                } else if (key == "threads") {
+                    has_threads = parse(value, c.threads) && c.threads;
+                    if (!has_threads) {
+                        return false;
+                    }
+                } else if (key == "spin_count") {
+                    has_spin_count = parse(value, c.spin_count);
+                    if (!has_spin_count) {
+                        return false;
+                    }
+                } else {
+                    return false;
+                }
+            }
+
+            if (!same_host || !has_threads || !has_spin_count) {
+                return false;
+            }
+
+            *this = c;
+            return true;
+        }
+
+    private:
+        /* The whole of `text` as a decimal `unsigned`. */
+        static bool parse(const std::string &text, unsigned &out)
+        {
+            const char *end = text.data() + text.size();
+            unsigned value;
+            std::from_chars_result const r =
+                std::from_chars(text.data(), end, value);
+            if (r.ec != std::errc {} || r.ptr != end) {
+                return false;
+            }
+
+            out = value;
+            return true;
+        }
+    };
+}
@@ -0,0 +1,222 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+#include <pool_config.hh>
+#include <stealing_queue.hh>
+
+namespace larva {
+
+    /**
+     * @brief       - Queue policies choose the queue owned by each worker. A
+     *                policy exposes `queue<T>` with `push()` and `try_pop()`,
+     *                `try_steal()` if other workers may take from it, and
+     *                `size()`, which any thread may call.
+     */
+    struct private_queue_policy {
+        template <typename T>
+        class queue {
+            std::queue<T> _queue;
+
+            /* Only the owner touches the queue; its size is mirrored for
+             * other threads to read. */
+            std::atomic<std::size_t> _size {0};
+
+        public:
+            void push(T data)
+            {
+                this->_queue.push(std::move(data));
+                this->_size.store(this->_queue.size(),
+                                  std::memory_order_relaxed);
+            }
+
+            bool empty() const
+            {
+                return this->_queue.empty();
+            }
+
+            std::size_t size() const
+            {
+                return this->_size.load(std::memory_order_relaxed);
+            }
+
+            bool try_pop(T& res)
+            {
+                if (this->_queue.empty()) {
+                    return false;
+                }
+
+                res = std::move(this->_queue.front());
+                this->_queue.pop();
+                this->_size.store(this->_queue.size(),
+                                  std::memory_order_relaxed);
+                return true;
+            }
+        };
+    };
+
+    struct stealing_queue_policy {
+        template <typename T>
+        using queue = larva::basic_stealing_queue<T>;
+    };
+
+    /**
+     * @brief       - Idle policies decide what a worker does when it found no
+     *                task, and how submitters wake it up again. `wait(ready)`
+     *                may return early, but must not sleep while `ready()` is
+     *                true. It returns whether the worker went to sleep.
+     *                `configure()` takes the pool's run-time parameters
+     *                before any worker starts.
+     */
+    struct yield_idle_policy {
+        void configure(const pool_config &) {}
+
+        template <typename Ready>
+        bool wait(Ready&&)
+        {
+            std::this_thread::yield();
+            return false;
+        }
+
+        void notify_one() {}
+        void notify_all() {}
+    };
+
+    struct spin_idle_policy {
+        void configure(const pool_config &) {}
+
+        template <typename Ready>
+        bool wait(Ready&&)
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#elif defined(__aarch64__)
+            asm volatile("yield");
+#endif
+            return false;
+        }
+
+        void notify_one() {}
+        void notify_all() {}
+    };
+
+    /**
+     * @brief       - Yield for a while, then sleep on a condition variable
+     *                until a submitter or the shutdown wakes the worker up.
+     *                Submitters only take the lock when a worker sleeps.
+     *                How long "a while" is comes from `spin_count`.
+     */
+    class park_idle_policy {
+        std::mutex _mutex;
+        std::condition_variable _cond;
+        std::atomic<unsigned> _sleepers {0};
+        unsigned _spin_count {pool_config::default_spin_count};
+
+    public:
+        void configure(const pool_config &config)
+        {
+            this->_spin_count = config.spin_count;
+        }
+
+        template <typename Ready>
+        bool wait(Ready&& ready)
+        {
+            for (unsigned i = 0; i < this->_spin_count; i++) {
+                if (ready()) {
+                    return false;
+                }
+
+                std::this_thread::yield();
+            }
+
+            std::unique_lock<std::mutex> lock(this->_mutex);
+            this->_sleepers.fetch_add(1);
+            bool const parked = !ready();
+            this->_cond.wait(lock, ready);
+            this->_sleepers.fetch_sub(1);
+            return parked;
+        }
+
+        void notify_one()
+        {
+            /* Pairs with the increment of `_sleepers`: either the sleeper sees
+             * the new task in `ready()`, or we see the sleeper here. */
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (this->_sleepers.load(std::memory_order_relaxed) > 0) {
+                std::lock_guard<std::mutex> lock(this->_mutex);
+                this->_cond.notify_one();
+            }
+        }
+
+        void notify_all()
+        {
+            std::lock_guard<std::mutex> lock(this->_mutex);
+            this->_cond.notify_all();
+        }
+    };
+
+    /**
+     * @brief       - Steal policies pick the victims of an idle worker. The
+     *                pool passes its own index, the number of workers and a
+     *                callable that tries to steal from a given index.
+     */
+    struct no_steal_policy {
+        static constexpr bool can_steal = false;
+
+        template <typename TrySteal>
+        static bool steal(unsigned, unsigned, TrySteal&&)
+        {
+            return false;
+        }
+    };
+
+    struct linear_steal_policy {
+        static constexpr bool can_steal = true;
+
+        template <typename TrySteal>
+        static bool steal(unsigned index, unsigned count, TrySteal&& try_steal)
+        {
+            for (unsigned i = 1; i < count; i++) {
+                /* Current thread will try to steal task from next thread.
+                 * We do that to avoid every threads steal from first thread. */
+                if (try_steal((index + i) % count)) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+    };
+
+    struct random_steal_policy {
+        static constexpr bool can_steal = true;
+
+        template <typename TrySteal>
+        static bool steal(unsigned index, unsigned count, TrySteal&& try_steal)
+        {
+            if (count < 2) {
+                return false;
+            }
+
+            /* Start at a random victim so that idle workers spread over the
+             * pool instead of hammering their neighbours. */
+            static thread_local unsigned seed = index * 2654435761u + 1;
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+
+            unsigned const start = seed % (count - 1);
+            for (unsigned i = 0; i < count - 1; i++) {
+                unsigned const offset = 1 + (start + i) % (count - 1);
+                if (try_steal((index + offset) % count)) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+    };
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include <task_label.hh>
+
+namespace larva {
+
+    /**
+     * @brief       - What one worker is doing at the instant of a snapshot.
+     *                The running task is only known while the pool watches
+     *                tasks, see `basic_pool::watch_tasks()`.
+     */
+    struct worker_state {
+        std::size_t queue_depth {0};
+        bool idle {false};
+        std::uint64_t idle_ns {0};
+        bool running {false};
+        std::uint16_t label {0};
+        std::int64_t task_since_ns {0};
+        std::uint64_t running_ns {0};
+    };
+
+    /**
+     * @brief       - Live view of a pool, taken without stopping it. Fields
+     *                are read one after the other, so they may be slightly
+     *                out of step with each other.
+     */
+    struct pool_state {
+        std::int64_t taken_ns {0};
+        std::size_t backlog {0};
+        std::vector<worker_state> workers {};
+
+        /**
+         * @brief       - Human readable dump: the shared backlog, then one
+         *                line per worker, then the `top` longest running
+         *                tasks.
+         */
+        void write(std::ostream &os, unsigned top = 5) const
+        {
+            auto const ms = [](std::uint64_t ns) { return ns / 1000000.0; };
+
+            std::size_t queued = this->backlog;
+            unsigned idle = 0;
+            for (const worker_state &w: this->workers) {
+                queued += w.queue_depth;
+                idle += w.idle;
+            }
+
+            os << "pool: " << this->workers.size() << " workers, " << idle
+               << " idle, " << this->backlog << " tasks in the shared queue, "
+               << queued << " queued in all\n";
+            for (std::size_t i = 0; i < this->workers.size(); i++) {
+                const worker_state &w = this->workers[i];
+                os << "  worker " << i << ": " << w.queue_depth << " queued, ";
+                if (w.running) {
+                    os << "running '" << task_label::name_of(w.label)
+                       << "' for " << ms(w.running_ns) << " ms\n";
+                } else if (w.idle) {
+                    os << "idle for " << ms(w.idle_ns) << " ms\n";
+                } else {
+                    os << "busy\n";
+                }
+            }
+
+            std::vector<std::size_t> order;
+            for (std::size_t i = 0; i < this->workers.size(); i++) {
+                if (this->workers[i].running) {
+                    order.push_back(i);
+                }
+            }
+
+            std::sort(order.begin(), order.end(),
+                      [this](std::size_t a, std::size_t b) {
+                          return this->workers[a].running_ns
+                                  > this->workers[b].running_ns;
+                      });
+            if (order.size() > top) {
+                order.resize(top);
+            }
+
+            if (!order.empty()) {
+                os << "longest running tasks:\n";
+            }
+
+            for (std::size_t i: order) {
+                const worker_state &w = this->workers[i];
+                os << "  " << ms(w.running_ns) << " ms '"
+                   << task_label::name_of(w.label) << "' on worker " << i
+                   << "\n";
+            }
+        }
+    };
+}
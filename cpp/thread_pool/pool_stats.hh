@@ -0,0 +1,127 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <clock.hh>
+
+namespace larva {
+
+    /**
+     * @brief       - What one worker did since the pool started.
+     */
+    struct worker_stats {
+        std::uint64_t tasks_executed {0};
+        std::uint64_t local_pops {0};
+        std::uint64_t global_pops {0};
+        std::uint64_t steals {0};
+        std::uint64_t failed_steals {0};
+        std::uint64_t idle_ns {0};
+        std::uint64_t parks {0};
+
+        worker_stats &operator+=(const worker_stats &other)
+        {
+            this->tasks_executed += other.tasks_executed;
+            this->local_pops += other.local_pops;
+            this->global_pops += other.global_pops;
+            this->steals += other.steals;
+            this->failed_steals += other.failed_steals;
+            this->idle_ns += other.idle_ns;
+            this->parks += other.parks;
+            return *this;
+        }
+    };
+
+    /**
+     * @brief       - Snapshot of a pool. `external` covers the tasks run by
+     *                other threads through `run_pending_task()`.
+     */
+    struct pool_stats {
+        std::vector<worker_stats> workers {};
+        worker_stats external {};
+
+        worker_stats total() const
+        {
+            worker_stats sum = this->external;
+            for (const worker_stats &w: this->workers) {
+                sum += w;
+            }
+
+            return sum;
+        }
+    };
+
+    /**
+     * @brief       - Live counters behind `worker_stats`, on their own cache
+     *                line. A worker is the only writer of its counters, so it
+     *                bumps them with a plain load and store instead of a
+     *                locked instruction; readers may see them slightly late,
+     *                never torn.
+     */
+    struct alignas(64) worker_counters {
+        std::atomic<std::uint64_t> tasks_executed {0};
+        std::atomic<std::uint64_t> local_pops {0};
+        std::atomic<std::uint64_t> global_pops {0};
+        std::atomic<std::uint64_t> steals {0};
+        std::atomic<std::uint64_t> failed_steals {0};
+        std::atomic<std::uint64_t> idle_ns {0};
+        std::atomic<std::uint64_t> parks {0};
+
+        /* Start of the current idle period in steady clock nanoseconds, or
+         * zero while busy, so that a snapshot also counts a worker that is
+         * still asleep. */
+        std::atomic<std::int64_t> idle_since {0};
+
+        void begin_idle()
+        {
+            this->idle_since.store(larva::now_ns(), std::memory_order_relaxed);
+        }
+
+        void end_idle(bool parked)
+        {
+            std::int64_t const start =
+                this->idle_since.load(std::memory_order_relaxed);
+            bump(this->idle_ns, static_cast<std::uint64_t>(larva::now_ns() - start));
+            this->idle_since.store(0, std::memory_order_relaxed);
+            if (parked) {
+                bump(this->parks);
+            }
+        }
+
+        static void bump(std::atomic<std::uint64_t> &counter,
+                         std::uint64_t n = 1)
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + n,
+                          std::memory_order_relaxed);
+        }
+
+        /* For counters shared by several threads. */
+        static void add(std::atomic<std::uint64_t> &counter,
+                        std::uint64_t n = 1)
+        {
+            counter.fetch_add(n, std::memory_order_relaxed);
+        }
+
+        worker_stats load() const
+        {
+            worker_stats s;
+            s.tasks_executed = this->tasks_executed.load(
+                                            std::memory_order_relaxed);
+            s.local_pops = this->local_pops.load(std::memory_order_relaxed);
+            s.global_pops = this->global_pops.load(std::memory_order_relaxed);
+            s.steals = this->steals.load(std::memory_order_relaxed);
+            s.failed_steals = this->failed_steals.load(
+                                            std::memory_order_relaxed);
+            s.idle_ns = this->idle_ns.load(std::memory_order_relaxed);
+            s.parks = this->parks.load(std::memory_order_relaxed);
+
+            std::int64_t const since =
+                this->idle_since.load(std::memory_order_relaxed);
+            if (since != 0) {
+                s.idle_ns += static_cast<std::uint64_t>(larva::now_ns() - since);
+            }
+
+            return s;
+        }
+    };
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <exception>
+#include <future>
+#include <memory_resource>
+#include <type_traits>
+
+namespace larva {
+
+    /**
+     * @brief       - Move-only task that runs `F` and publishes the result
+     *                through a `std::promise`. Unlike `std::packaged_task`,
+     *                the callable is stored inline and the shared state can
+     *                be allocated from a memory resource.
+     */
+    template <typename F, typename R>
+    class promise_task {
+        F _f;
+        std::promise<R> _promise;
+
+    public:
+        explicit promise_task(F f): _f {std::move(f)} {}
+
+        promise_task(std::allocator_arg_t,
+                     std::pmr::memory_resource *resource,
+                     F f):
+            _f {std::move(f)},
+            _promise {std::allocator_arg,
+                      std::pmr::polymorphic_allocator<char> {resource}} {}
+
+        promise_task(promise_task&&) = default;
+        promise_task& operator=(promise_task&&) = default;
+
+        std::future<R> get_future()
+        {
+            return this->_promise.get_future();
+        }
+
+        void operator() ()
+        {
+            try {
+                this->call(std::is_void<R> {});
+            } catch (...) {
+                this->_promise.set_exception(std::current_exception());
+            }
+        }
+
+    private:
+        void call(std::false_type)
+        {
+            this->_promise.set_value(this->_f());
+        }
+
+        void call(std::true_type)
+        {
+            this->_f();
+            this->_promise.set_value();
+        }
+    };
+}
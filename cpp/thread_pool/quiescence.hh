@@ -0,0 +1,156 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include <futex.hh>
+
+namespace larva {
+
+    /**
+     * @brief       - Counts the tasks in flight in a pool, so that a thread
+     *                can wait until they are all done, or until every task of
+     *                an epoch is done.
+     *                - Each shard has its own cache line and is only touched
+     *                  by the threads mapped on it, so counting a task does
+     *                  not contend with other workers.
+     *                - Counters only grow: a task is in flight while its
+     *                  `submitted` increment has no matching `completed` one.
+     *                - Every task carries the parity of its epoch. A barrier
+     *                  opens a new epoch and waits for the old parity to
+     *                  drain. Tasks submitted by a task join its epoch.
+     *                - A finishing task only looks at the shards, and wakes
+     *                  the waiters through one futex, when somebody waits.
+     */
+    class quiescence {
+        struct alignas(64) shard {
+            std::atomic<std::uint64_t> submitted[2] {{0}, {0}};
+            std::atomic<std::uint64_t> completed[2] {{0}, {0}};
+        };
+
+        std::unique_ptr<shard[]> _shards;
+        unsigned _count;
+        std::atomic<unsigned> _epoch {0};
+        std::atomic<unsigned> _waiters {0};
+        std::atomic<std::uint32_t> _wake_seq {0};
+        std::mutex _barrier_mutex {};
+
+    public:
+        explicit quiescence(unsigned shard_count):
+            _shards {std::make_unique<shard[]>(shard_count)},
+            _count {shard_count} {}
+
+        quiescence(const quiescence&) = delete;
+        quiescence& operator=(const quiescence&) = delete;
+
+        /**
+         * @brief       - Count a new task on `index` in the current epoch,
+         *                and return the epoch to pass to `leave()`.
+         */
+        unsigned enter(unsigned index)
+        {
+            shard &s = this->_shards[index];
+            for (;;) {
+                unsigned const epoch = this->_epoch.load();
+                s.submitted[epoch & 1].fetch_add(1);
+
+                /* A barrier opened a new epoch meanwhile and may have missed
+                 * the increment: undo it and count in the new epoch. */
+                if (this->_epoch.load() == epoch) {
+                    return epoch;
+                }
+
+                this->leave(index, epoch);
+            }
+        }
+
+        /**
+         * @brief       - Count a new task on `index` in the epoch of the task
+         *                that submits it. The parent is still in flight, so
+         *                the epoch cannot have drained yet.
+         */
+        void enter(unsigned index, unsigned epoch)
+        {
+            this->_shards[index].submitted[epoch & 1].fetch_add(1);
+        }
+
+        void leave(unsigned index, unsigned epoch)
+        {
+            this->_shards[index].completed[epoch & 1].fetch_add(1);
+            if (this->_waiters.load() > 0 && this->drained(epoch & 1)) {
+                this->_wake_seq.fetch_add(1);
+                larva::futex_wake_all(this->_wake_seq);
+            }
+        }
+
+        bool idle() const
+        {
+            return this->in_flight(0) + this->in_flight(1) == 0;
+        }
+
+        /**
+         * @brief       - Block until no task is in flight.
+         */
+        void wait_idle()
+        {
+            this->wait_until([this]() -> bool { return this->idle(); });
+        }
+
+        /**
+         * @brief       - Block until every task counted before the call, and
+         *                every task they submit, has left. Tasks submitted
+         *                from outside meanwhile belong to the next epoch and
+         *                are not waited for.
+         */
+        void barrier()
+        {
+            std::lock_guard<std::mutex> lock(this->_barrier_mutex);
+            unsigned const parity = this->_epoch.fetch_add(1) & 1;
+            this->wait_until([this, parity]() -> bool {
+                return this->drained(parity);
+            });
+        }
+
+    private:
+        /* Completions are summed before submissions: each completion is
+         * preceded by its submission, so a zero can not come from a task
+         * that was missed. */
+        std::uint64_t in_flight(unsigned parity) const
+        {
+            std::uint64_t completed = 0;
+            for (unsigned i = 0; i < this->_count; i++) {
+                completed += this->_shards[i].completed[parity].load();
+            }
+
+            std::uint64_t submitted = 0;
+            for (unsigned i = 0; i < this->_count; i++) {
+                submitted += this->_shards[i].submitted[parity].load();
+            }
+
+            return submitted - completed;
+        }
+
+        bool drained(unsigned parity) const
+        {
+            return this->in_flight(parity) == 0;
+        }
+
+        template <typename Pred>
+        void wait_until(Pred done)
+        {
+            for (;;) {
+                std::uint32_t const seq = this->_wake_seq.load();
+                if (done()) {
+                    return;
+                }
+
+                this->_waiters.fetch_add(1);
+                if (!done()) {
+                    larva::futex_wait(this->_wake_seq, seq);
+                }
+                this->_waiters.fetch_sub(1);
+            }
+        }
+    };
+}
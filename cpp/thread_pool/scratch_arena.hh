@@ -0,0 +1,152 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+namespace larva {
+
+    /**
+     * @brief       - Monotonic arena for short-lived scratch memory. An
+     *                allocation bumps a cursor and a deallocation does
+     *                nothing; `rewind()` moves the cursor back to a `mark()`.
+     *                Chunks are kept across rewinds, so a warm arena never
+     *                goes back to the upstream resource.
+     */
+    class scratch_arena: public std::pmr::memory_resource {
+    public:
+        static constexpr std::size_t initial_chunk_size = 64 * 1024;
+
+        struct mark_type {
+            std::size_t chunk;
+            std::size_t offset;
+        };
+
+        /**
+         * @brief       - Rewind the arena to where it was when the scope was
+         *                opened, including when leaving it by an exception.
+         */
+        class scope {
+            scratch_arena &_arena;
+            mark_type _mark;
+
+        public:
+            explicit scope(scratch_arena &arena):
+                _arena {arena}, _mark {arena.mark()} {}
+
+            ~scope()
+            {
+                this->_arena.rewind(this->_mark);
+            }
+
+            scope(const scope&) = delete;
+            scope& operator=(const scope&) = delete;
+        };
+
+    private:
+        struct chunk {
+            char *data;
+            std::size_t size;
+        };
+
+        std::pmr::memory_resource *_upstream;
+        std::vector<chunk> _chunks {};
+        std::size_t _current {0};
+        std::size_t _offset {0};
+
+    public:
+        explicit scratch_arena(std::pmr::memory_resource *upstream
+                                    = std::pmr::new_delete_resource()):
+            _upstream {upstream} {}
+
+        scratch_arena(const scratch_arena&) = delete;
+        scratch_arena& operator=(const scratch_arena&) = delete;
+
+        ~scratch_arena()
+        {
+            for (chunk &c: this->_chunks) {
+                this->_upstream->deallocate(c.data,
+                                            c.size,
+                                            alignof(std::max_align_t));
+            }
+        }
+
+        mark_type mark() const
+        {
+            return {this->_current, this->_offset};
+        }
+
+        void rewind(mark_type m)
+        {
+            this->_current = m.chunk;
+            this->_offset = m.offset;
+        }
+
+    protected:
+        void *do_allocate(std::size_t bytes, std::size_t alignment) override
+        {
+            while (this->_current < this->_chunks.size()) {
+                chunk &c = this->_chunks[this->_current];
+                std::uintptr_t const base =
+                    reinterpret_cast<std::uintptr_t>(c.data);
+                std::size_t const offset =
+                    ((base + this->_offset + alignment - 1) & ~(alignment - 1))
+                    - base;
+
+                if (offset + bytes <= c.size) {
+                    this->_offset = offset + bytes;
+                    return c.data + offset;
+                }
+
+                /* Does not fit in this chunk, try the next retained one. */
+                this->_current++;
+                this->_offset = 0;
+            }
+
+            std::size_t size = this->_chunks.empty()
+                                ? initial_chunk_size
+                                : this->_chunks.back().size * 2;
+            while (size < bytes + alignment) {
+                size *= 2;
+            }
+
+            this->_chunks.reserve(this->_chunks.size() + 1);
+            char *data = static_cast<char *>(
+                this->_upstream->allocate(size, alignof(std::max_align_t)));
+            this->_chunks.push_back({data, size});
+            this->_current = this->_chunks.size() - 1;
+            this->_offset = 0;
+
+            return this->do_allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void *, std::size_t, std::size_t) override {}
+
+        bool do_is_equal(const std::pmr::memory_resource &other)
+                                            const noexcept override
+        {
+            return this == &other;
+        }
+    };
+
+    namespace this_task {
+        namespace detail {
+            inline thread_local larva::scratch_arena *arena {nullptr};
+        }
+
+        /**
+         * @brief       - Scratch memory of the running task. It is rewound as
+         *                soon as the task returns, so nothing allocated here
+         *                may outlive it. Outside a pool worker, this is the
+         *                global heap.
+         */
+        inline std::pmr::memory_resource &arena()
+        {
+            if (detail::arena) {
+                return *detail::arena;
+            }
+
+            return *std::pmr::new_delete_resource();
+        }
+    }
+}
@@ -6,16 +6,18 @@
 namespace larva {
     typedef f_wrapper data_type;
 
-    class stealing_queue {
-        std::deque<data_type> _queue;
+    template <typename T>
+    class basic_stealing_queue {
+        std::deque<T> _queue;
         mutable std::mutex _mutex; /* Change mutex in const method. */
-    
+
     public:
-        stealing_queue() = default;
-        stealing_queue(const stealing_queue& other) = delete;
-        stealing_queue& operator=(const stealing_queue& other) = delete;
+        basic_stealing_queue() = default;
+        basic_stealing_queue(const basic_stealing_queue& other) = delete;
+        basic_stealing_queue& operator=(const basic_stealing_queue& other)
+                                                                    = delete;
 
-        void push(data_type data) {
+        void push(T data) {
             std::lock_guard<std::mutex> lock(this->_mutex);
             this->_queue.push_front(std::move(data));
         }
@@ -25,7 +27,12 @@ namespace larva {
             return this->_queue.empty();
         }
 
-        bool try_pop(data_type& res) {
+        std::size_t size() const {
+            std::lock_guard<std::mutex> lock(this->_mutex);
+            return this->_queue.size();
+        }
+
+        bool try_pop(T& res) {
             std::lock_guard<std::mutex> lock(this->_mutex);
             if (this->_queue.empty()) {
                 return false;
@@ -36,7 +43,7 @@ namespace larva {
             return true;
         }
 
-        bool try_steal(data_type& res) {
+        bool try_steal(T& res) {
             std::lock_guard<std::mutex> lock(this->_mutex);
             if (this->_queue.empty()) {
                 return false;
@@ -47,4 +54,6 @@ namespace larva {
             return true;
         }
     };
-}
\ No newline at end of file
+
+    typedef basic_stealing_queue<data_type> stealing_queue;
+}
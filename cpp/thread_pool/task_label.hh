@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace larva {
+
+    /**
+     * @brief       - Interned name for a kind of task, used to group what
+     *                the pool measures. Label 0 is the default, unlabeled.
+     *                Interning takes a lock, so keep labels around, e.g. as
+     *                `static const task_label parse {"parse"};`, rather than
+     *                building one per submit.
+     */
+    class task_label {
+    public:
+        static constexpr unsigned capacity = 256;
+
+    private:
+        struct registry {
+            std::string names[capacity] {"unlabeled"};
+            std::atomic<unsigned> count {1};
+            std::mutex mutex {};
+        };
+
+        static registry &labels()
+        {
+            static registry r;
+            return r;
+        }
+
+        std::uint16_t _id {0};
+
+    public:
+        task_label() = default;
+
+        /* Throws `std::length_error` once `capacity` names are taken. */
+        explicit task_label(std::string_view name)
+        {
+            registry &r = labels();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            unsigned const count = r.count.load(std::memory_order_relaxed);
+            for (unsigned i = 0; i < count; i++) {
+                if (r.names[i] == name) {
+                    this->_id = static_cast<std::uint16_t>(i);
+                    return;
+                }
+            }
+
+            if (count == capacity) {
+                throw std::length_error("larva::task_label: too many labels");
+            }
+
+            r.names[count] = std::string(name);
+            r.count.store(count + 1, std::memory_order_release);
+            this->_id = static_cast<std::uint16_t>(count);
+        }
+
+        std::uint16_t id() const
+        {
+            return this->_id;
+        }
+
+        std::string_view name() const
+        {
+            return name_of(this->_id);
+        }
+
+        /* Number of labels interned so far, the default one included. */
+        static unsigned count()
+        {
+            return labels().count.load(std::memory_order_acquire);
+        }
+
+        static std::string_view name_of(unsigned id)
+        {
+            return id < count() ? std::string_view(labels().names[id])
+                                : std::string_view();
+        }
+    };
+}
@@ -0,0 +1,159 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+#include <thread>
+#include <vector>
+
+namespace larva {
+
+    /**
+     * @brief       - Slab allocator for the task objects of one worker.
+     *                Blocks of 64, 128, 256 and 512 bytes are carved from
+     *                large chunks and recycled through per-size free lists:
+     *                - The owner allocates and frees on a plain list.
+     *                - Other threads free on an atomic list, which the owner
+     *                  takes over in one exchange when its own list is empty.
+     *                Bigger or over-aligned requests go to the upstream
+     *                resource. Only the owner thread may allocate.
+     */
+    class task_slab: public std::pmr::memory_resource {
+    public:
+        static constexpr std::size_t block_alignment = 64;
+        static constexpr std::size_t class_count = 4;
+        static constexpr std::size_t chunk_size = 64 * 1024;
+
+    private:
+        struct block {
+            block *next;
+        };
+
+        struct alignas(64) size_class {
+            block *local {nullptr};
+            std::atomic<block *> remote {nullptr};
+        };
+
+        size_class _classes[class_count] {};
+        std::thread::id _owner {};
+        std::pmr::memory_resource *_upstream;
+        std::vector<void *> _chunks {};
+        char *_cursor {nullptr};
+        char *_end {nullptr};
+
+    public:
+        explicit task_slab(std::pmr::memory_resource *upstream
+                                = std::pmr::new_delete_resource()):
+            _upstream {upstream} {}
+
+        task_slab(const task_slab&) = delete;
+        task_slab& operator=(const task_slab&) = delete;
+
+        ~task_slab()
+        {
+            for (void *chunk: this->_chunks) {
+                this->_upstream->deallocate(chunk,
+                                            chunk_size,
+                                            block_alignment);
+            }
+        }
+
+        /**
+         * @brief       - Make the calling thread the owner of the slab.
+         */
+        void bind_to_current_thread()
+        {
+            this->_owner = std::this_thread::get_id();
+        }
+
+    protected:
+        void *do_allocate(std::size_t bytes, std::size_t alignment) override
+        {
+            int const index = class_of(bytes, alignment);
+            if (index < 0) {
+                return this->_upstream->allocate(bytes, alignment);
+            }
+
+            size_class &c = this->_classes[index];
+            if (!c.local) {
+                c.local = c.remote.exchange(nullptr, std::memory_order_acquire);
+            }
+
+            if (c.local) {
+                block *b = c.local;
+                c.local = b->next;
+                return b;
+            }
+
+            return this->carve(block_size(index));
+        }
+
+        void do_deallocate(void *p,
+                           std::size_t bytes,
+                           std::size_t alignment) override
+        {
+            int const index = class_of(bytes, alignment);
+            if (index < 0) {
+                this->_upstream->deallocate(p, bytes, alignment);
+                return;
+            }
+
+            size_class &c = this->_classes[index];
+            block *b = static_cast<block *>(p);
+            if (std::this_thread::get_id() == this->_owner) {
+                b->next = c.local;
+                c.local = b;
+                return;
+            }
+
+            b->next = c.remote.load(std::memory_order_relaxed);
+            while (!c.remote.compare_exchange_weak(b->next,
+                                                   b,
+                                                   std::memory_order_release,
+                                                   std::memory_order_relaxed))
+            {}
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other)
+                                            const noexcept override
+        {
+            return this == &other;
+        }
+
+    private:
+        static constexpr std::size_t block_size(int index)
+        {
+            return std::size_t {64} << index;
+        }
+
+        static int class_of(std::size_t bytes, std::size_t alignment)
+        {
+            if (alignment > block_alignment) {
+                return -1;
+            }
+
+            for (std::size_t i = 0; i < class_count; i++) {
+                if (bytes <= block_size(i)) {
+                    return static_cast<int>(i);
+                }
+            }
+
+            return -1;
+        }
+
+        void *carve(std::size_t size)
+        {
+            if (static_cast<std::size_t>(this->_end - this->_cursor) < size) {
+                this->_chunks.reserve(this->_chunks.size() + 1);
+                char *chunk = static_cast<char *>(
+                    this->_upstream->allocate(chunk_size, block_alignment));
+                this->_chunks.push_back(chunk);
+                this->_cursor = chunk;
+                this->_end = chunk + chunk_size;
+            }
+
+            void *p = this->_cursor;
+            this->_cursor += size;
+            return p;
+        }
+    };
+}
@@ -0,0 +1,514 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include <clock.hh>
+
+namespace larva {
+
+    enum class trace_event_type: std::uint8_t {
+        submit,         /* `task` submitted by `parent`. */
+        task_begin,
+        task_end,
+        steal,          /* `task` stolen from worker `parent`. */
+        park,           /* Asleep since `ts`, until the next unpark. */
+        unpark
+    };
+
+    /**
+     * @brief       - One compact trace record. Task ids are never zero, a
+     *                zero parent means the task was submitted from outside
+     *                any task.
+     */
+    struct trace_event {
+        std::int64_t ts;
+        std::uint64_t task;
+        std::uint64_t parent;
+        std::uint32_t lane;
+        trace_event_type type;
+    };
+
+    /**
+     * @brief       - Ring of trace events for one writer, which overwrites
+     *                the oldest events once full. Each slot is a seqlock:
+     *                its sequence holds the index of the event in it plus
+     *                one, or zero while it is being written. `collect()` may
+     *                run at any time and drops the slots rewritten while it
+     *                was reading them, so it never returns a torn event.
+     */
+    class trace_ring {
+        struct slot {
+            std::atomic<std::uint64_t> sequence {0};
+            std::atomic<std::int64_t> ts {0};
+            std::atomic<std::uint64_t> task {0};
+            std::atomic<std::uint64_t> parent {0};
+            std::atomic<std::uint64_t> kind {0};
+        };
+
+        std::unique_ptr<slot[]> _slots;
+        std::uint64_t _mask;
+        std::atomic<std::uint64_t> _head {0};
+
+    public:
+        /* The capacity is rounded up to a power of two. */
+        explicit trace_ring(std::size_t capacity)
+        {
+            std::size_t size = 1;
+            while (size < capacity) {
+                size <<= 1;
+            }
+
+            this->_mask = size - 1;
+            this->_slots = std::make_unique<slot[]>(size);
+        }
+
+        void push(const trace_event &e)
+        {
+            std::uint64_t const head =
+                this->_head.load(std::memory_order_relaxed);
+            slot &s = this->_slots[head & this->_mask];
+
+            /* Claim the slot before touching the event: a reader that sees
+             * any of the stores below then sees the claim. */
+            s.sequence.store(0, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            s.ts.store(e.ts, std::memory_order_relaxed);
+            s.task.store(e.task, std::memory_order_relaxed);
+            s.parent.store(e.parent, std::memory_order_relaxed);
+            s.kind.store((std::uint64_t {e.lane} << 8)
+                            | static_cast<std::uint8_t>(e.type),
+                         std::memory_order_relaxed);
+            s.sequence.store(head + 1, std::memory_order_release);
+            this->_head.store(head + 1, std::memory_order_release);
+        }
+
+        void collect(std::vector<trace_event> &out) const
+        {
+            std::uint64_t const capacity = this->_mask + 1;
+            std::uint64_t const end = this->_head.load(std::memory_order_acquire);
+            std::uint64_t const begin = end > capacity ? end - capacity : 0;
+
+            out.reserve(out.size() + (end - begin));
+            for (std::uint64_t i = begin; i < end; i++) {
+                const slot &s = this->_slots[i & this->_mask];
+                if (s.sequence.load(std::memory_order_acquire) != i + 1) {
+                    continue;
+                }
+
+                std::uint64_t const kind =
+                    s.kind.load(std::memory_order_relaxed);
+                trace_event const e {
+                    s.ts.load(std::memory_order_relaxed),
+                    s.task.load(std::memory_order_relaxed),
+                    s.parent.load(std::memory_order_relaxed),
+                    static_cast<std::uint32_t>(kind >> 8),
+                    static_cast<trace_event_type>(kind & 0xff)};
+
+                /* Rewritten while we read: drop it. */
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (s.sequence.load(std::memory_order_relaxed) == i + 1) {
+                    out.push_back(e);
+                }
+            }
+        }
+    };
+
+    /**
+     * @brief       - Trace rings of a pool: one per worker, written without
+     *                locks, and a last one shared by every other thread.
+     *                Task ids carry the lane that submitted the task in their
+     *                top bits, so handing them out needs no shared counter.
+     */
+    class task_trace {
+        struct alignas(64) lane {
+            trace_ring ring;
+            std::uint64_t next_id {0};
+
+            explicit lane(std::size_t capacity): ring {capacity} {}
+        };
+
+        std::vector<std::unique_ptr<lane>> _lanes {};
+        std::mutex _external_mutex {};
+
+    public:
+        task_trace(unsigned workers, std::size_t capacity)
+        {
+            for (unsigned i = 0; i <= workers; i++) {
+                this->_lanes.push_back(std::make_unique<lane>(capacity));
+            }
+        }
+
+        unsigned workers() const
+        {
+            return static_cast<unsigned>(this->_lanes.size() - 1);
+        }
+
+        /* `index` is the worker index, or `workers()` for other threads. */
+        std::uint64_t new_id(unsigned index)
+        {
+            lane &l = *this->_lanes[index];
+            if (index == this->workers()) {
+                std::lock_guard<std::mutex> lock(this->_external_mutex);
+                return (std::uint64_t {index + 1} << 40) | ++l.next_id;
+            }
+
+            return (std::uint64_t {index + 1} << 40) | ++l.next_id;
+        }
+
+        void record(unsigned index,
+                    trace_event_type type,
+                    std::uint64_t task,
+                    std::uint64_t parent = 0,
+                    std::int64_t ts = larva::now_ns())
+        {
+            trace_event const e {ts, task, parent, index, type};
+            if (index == this->workers()) {
+                std::lock_guard<std::mutex> lock(this->_external_mutex);
+                this->_lanes[index]->ring.push(e);
+                return;
+            }
+
+            this->_lanes[index]->ring.push(e);
+        }
+
+        /**
+         * @brief       - Copy the events still in the rings, oldest first.
+         */
+        std::vector<trace_event> collect() const
+        {
+            std::vector<trace_event> events;
+            for (auto &l: this->_lanes) {
+                l->ring.collect(events);
+            }
+
+            std::stable_sort(events.begin(), events.end(),
+                             [](const trace_event &a, const trace_event &b) {
+                                 return a.ts < b.ts;
+                             });
+            return events;
+        }
+    };
+
+    /**
+     * @brief       - Write events in the Chrome trace-event JSON format, which
+     *                chrome://tracing and the Perfetto UI both open. Each lane
+     *                is a thread, each task a slice, parks are "parked"
+     *                slices, and arrows link a submit to the task start.
+     */
+    inline void write_chrome_trace(std::ostream &os,
+                                   const std::vector<trace_event> &events,
+                                   unsigned workers)
+    {
+        std::int64_t const origin = events.empty() ? 0 : events.front().ts;
+        auto const us = [origin](std::int64_t ts) {
+            return static_cast<double>(ts - origin) / 1000.0;
+        };
+
+        os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        bool first = true;
+        auto const next = [&os, &first]() -> std::ostream & {
+            os << (first ? "\n" : ",\n");
+            first = false;
+            return os;
+        };
+
+        for (unsigned i = 0; i <= workers; i++) {
+            next() << "{\"ph\":\"M\",\"pid\":1,\"tid\":" << i
+                   << ",\"name\":\"thread_name\",\"args\":{\"name\":\""
+                   << (i < workers ? "worker " : "external");
+            if (i < workers) {
+                os << i;
+            }
+            os << "\"}}";
+        }
+
+        /* Open tasks and parks per lane, matched to their end. */
+        std::vector<std::vector<trace_event>> open(workers + 1);
+        std::vector<trace_event> parked(workers + 1, trace_event {});
+        for (const trace_event &e: events) {
+            unsigned const lane = e.lane <= workers ? e.lane : workers;
+            switch (e.type) {
+            case trace_event_type::submit:
+                next() << "{\"ph\":\"s\",\"pid\":1,\"tid\":" << lane
+                       << ",\"ts\":" << us(e.ts)
+                       << ",\"name\":\"submit\",\"cat\":\"task\",\"id\":"
+                       << e.task << "}";
+                break;
+
+            case trace_event_type::task_begin:
+                open[lane].push_back(e);
+                next() << "{\"ph\":\"f\",\"bp\":\"e\",\"pid\":1,\"tid\":"
+                       << lane << ",\"ts\":" << us(e.ts)
+                       << ",\"name\":\"submit\",\"cat\":\"task\",\"id\":"
+                       << e.task << "}";
+                break;
+
+            case trace_event_type::task_end:
+                /* A begin lost to the ring wrapping leaves a lone end. */
+                if (!open[lane].empty()
+                    && open[lane].back().task == e.task)
+                {
+                    const trace_event &b = open[lane].back();
+                    next() << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << lane
+                           << ",\"ts\":" << us(b.ts)
+                           << ",\"dur\":" << us(e.ts) - us(b.ts)
+                           << ",\"name\":\"task\",\"cat\":\"task\","
+                           << "\"args\":{\"id\":" << b.task
+                           << ",\"parent\":" << b.parent << "}}";
+                    open[lane].pop_back();
+                }
+                break;
+
+            case trace_event_type::steal:
+                next() << "{\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":"
+                       << lane << ",\"ts\":" << us(e.ts)
+                       << ",\"name\":\"steal\",\"args\":{\"id\":" << e.task
+                       << ",\"victim\":" << e.parent << "}}";
+                break;
+
+            case trace_event_type::park:
+                parked[lane] = e;
+                break;
+
+            case trace_event_type::unpark:
+                if (parked[lane].type == trace_event_type::park
+                    && parked[lane].ts)
+                {
+                    next() << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << lane
+                           << ",\"ts\":" << us(parked[lane].ts)
+                           << ",\"dur\":" << us(e.ts) - us(parked[lane].ts)
+                           << ",\"name\":\"parked\",\"cat\":\"idle\"}";
+                    parked[lane] = trace_event {};
+                }
+                break;
+            }
+        }
+
+        os << "\n]}\n";
+    }
+
+    /* Header of a raw trace dump, followed by the worker count and the
+     * event count, then 32 bytes per event, in host byte order. */
+    inline constexpr char trace_magic[8] = {'L', 'V', 'T', 'R', 'A', 'C', 'E',
+                                            '1'};
+
+    /**
+     * @brief       - Dump events as is, for offline tools such as
+     *                `tools/work_span`.
+     */
+    inline void save_trace(std::ostream &os,
+                           const std::vector<trace_event> &events,
+                           unsigned workers)
+    {
+        auto const put = [&os](const auto &value) {
+            os.write(reinterpret_cast<const char *>(&value), sizeof(value));
+        };
+
+        os.write(trace_magic, sizeof(trace_magic));
+        put(std::uint32_t {workers});
+        put(std::uint64_t {events.size()});
+        for (const trace_event &e: events) {
+            put(e.ts);
+            put(e.task);
+            put(e.parent);
+            put(std::uint64_t {(std::uint64_t {e.lane} << 8)
+                               | static_cast<std::uint8_t>(e.type)});
+        }
+    }
+
+    /**
+     * @brief       - Read back a dump of `save_trace()`. Returns false, with
+     *                whatever was read so far, on a malformed stream.
+     */
+    inline bool load_trace(std::istream &is,
+                           std::vector<trace_event> &events,
+                           unsigned &workers)
+    {
+        auto const get = [&is](auto &value) -> bool {
+            return static_cast<bool>(
+                is.read(reinterpret_cast<char *>(&value), sizeof(value)));
+        };
+
+        char magic[sizeof(trace_magic)];
+        std::uint32_t lanes;
+        std::uint64_t count;
+        if (!is.read(magic, sizeof(magic))
+            || std::memcmp(magic, trace_magic, sizeof(magic)) != 0
+            || !get(lanes) || !get(count))
+        {
+            return false;
+        }
+
+        workers = lanes;
+        for (std::uint64_t i = 0; i < count; i++) {
+            trace_event e {};
+            std::uint64_t kind;
+            if (!get(e.ts) || !get(e.task) || !get(e.parent) || !get(kind)) {
+                return false;
+            }
+
+            e.lane = static_cast<std::uint32_t>(kind >> 8);
+            e.type = static_cast<trace_event_type>(kind & 0xff);
+            events.push_back(e);
+        }
+
+        return true;
+    }
+
+    namespace detail {
+
+        struct trace_task {
+            std::uint64_t parent {0};
+            std::int64_t begin {0};
+            std::int64_t end {0};
+            std::int64_t nested {0};    /* Run inline, inside this task. */
+            std::int64_t offset {0};    /* Own work done before the submit. */
+            std::int64_t finish {0};    /* Earliest finish, from its begin. */
+            bool complete {false};
+            std::vector<std::uint64_t> children {};
+
+            std::int64_t exclusive() const
+            {
+                return this->end - this->begin - this->nested;
+            }
+        };
+    }
+
+    /**
+     * @brief       - Work and span of a trace, in the manner of Cilkview.
+     *                - work: the time spent in tasks, without the tasks they
+     *                  ran inline while waiting.
+     *                - span: the longest chain of dependent work. A child can
+     *                  not start before its parent has done the work
+     *                  preceding its submit, and a task is not over before
+     *                  its children are.
+     *                Only tasks with both ends traced count.
+     */
+    struct work_span {
+        std::size_t tasks {0};
+        std::uint64_t steals {0};
+        std::int64_t work {0};
+        std::int64_t span {0};
+        std::int64_t first {0};         /* Begin of the first task. */
+        std::int64_t last {0};          /* End of the last task. */
+
+        /* The most cores the job can use. */
+        double parallelism() const
+        {
+            return this->span ? static_cast<double>(this->work) / this->span
+                              : 0;
+        }
+
+        /* The speedup a greedy scheduler guarantees on `cores`. */
+        double greedy(unsigned cores) const
+        {
+            return this->work
+                   / (static_cast<double>(this->work) / cores + this->span);
+        }
+
+        static work_span of(std::vector<trace_event> events,
+                            unsigned workers)
+        {
+            std::stable_sort(events.begin(), events.end(),
+                             [](const trace_event &a, const trace_event &b) {
+                                 return a.ts < b.ts;
+                             });
+
+            /* Replay each lane with a stack of the tasks it is running, to
+             * take inline runs out of the enclosing task and to find where
+             * in its parent's work each task was submitted. */
+            work_span result;
+            std::unordered_map<std::uint64_t, detail::trace_task> tasks;
+            std::vector<std::vector<std::uint64_t>> running(workers + 1);
+            for (const trace_event &e: events) {
+                std::vector<std::uint64_t> &stack =
+                    running[std::min<std::uint32_t>(e.lane, workers)];
+                switch (e.type) {
+                case trace_event_type::submit:
+                    tasks[e.task].parent = e.parent;
+                    if (!stack.empty() && stack.back() == e.parent) {
+                        const detail::trace_task &p = tasks[e.parent];
+                        tasks[e.task].offset = e.ts - p.begin - p.nested;
+                    }
+                    break;
+
+                case trace_event_type::task_begin:
+                    tasks[e.task].parent = e.parent;
+                    tasks[e.task].begin = e.ts;
+                    stack.push_back(e.task);
+                    break;
+
+                case trace_event_type::task_end:
+                    if (stack.empty() || stack.back() != e.task) {
+                        break;
+                    }
+
+                    stack.pop_back();
+                    tasks[e.task].end = e.ts;
+                    tasks[e.task].complete = tasks[e.task].begin != 0;
+                    if (!stack.empty()) {
+                        tasks[stack.back()].nested +=
+                            e.ts - tasks[e.task].begin;
+                    }
+                    break;
+
+                case trace_event_type::steal:
+                    result.steals++;
+                    break;
+
+                default:
+                    break;
+                }
+            }
+
+            /* Children begin after their parent, so walking by decreasing
+             * begin settles every child before its parent. */
+            std::vector<std::uint64_t> order;
+            for (auto &[id, t]: tasks) {
+                if (t.complete) {
+                    order.push_back(id);
+                }
+            }
+
+            std::sort(order.begin(), order.end(),
+                      [&tasks](std::uint64_t a, std::uint64_t b) {
+                          return tasks[a].begin < tasks[b].begin;
+                      });
+            for (std::uint64_t id: order) {
+                auto p = tasks.find(tasks[id].parent);
+                if (p != tasks.end() && p->second.complete) {
+                    p->second.children.push_back(id);
+                }
+            }
+
+            for (auto it = order.rbegin(); it != order.rend(); ++it) {
+                detail::trace_task &t = tasks[*it];
+                std::int64_t const own = t.exclusive();
+                t.finish = own;
+                for (std::uint64_t c: t.children) {
+                    const detail::trace_task &child = tasks[c];
+                    std::int64_t const start =
+                        std::clamp<std::int64_t>(child.offset, 0, own);
+                    t.finish = std::max(t.finish, start + child.finish);
+                }
+
+                result.work += own;
+                result.span = std::max(result.span, t.finish);
+                result.first = result.first ? std::min(result.first, t.begin)
+                                            : t.begin;
+                result.last = std::max(result.last, t.end);
+            }
+
+            result.tasks = order.size();
+            return result;
+        }
+    };
+}
@@ -1,10 +1,11 @@
 #include <thread_pool.hh>
 #include <stealing_thread_pool.hh>
 
-thread_local std::unique_ptr<larva::thread_pool::local_queue_type> 
-larva::thread_pool::_local_work_queue {nullptr};
+/* Instantiate the stock pools here so the library compiles every member. */
+template class larva::basic_pool<larva::private_queue_policy,
+                                 larva::park_idle_policy,
+                                 larva::no_steal_policy>;
 
-thread_local larva::stealing_queue
-*larva::stealing_thread_pool::_local_work_queue {nullptr};
-
-thread_local unsigned larva::stealing_thread_pool::_index {0};
\ No newline at end of file
+template class larva::basic_pool<larva::stealing_queue_policy,
+                                 larva::park_idle_policy,
+                                 larva::linear_steal_policy>;
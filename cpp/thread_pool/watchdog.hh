@@ -0,0 +1,230 @@
+#pragma once
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+
+#include <pool_state.hh>
+#include <task_label.hh>
+
+namespace larva {
+
+    namespace detail {
+        /* Bumped by the signal handler, once per signal. Each watchdog
+         * remembers the count it last dumped for, so every watchdog on a
+         * signal dumps. A lock-free atomic add is async-signal-safe. */
+        inline std::atomic<unsigned> dump_requests[NSIG] {};
+
+        inline void request_dump(int signo)
+        {
+            dump_requests[signo].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /* Watchdogs dumping on each signal, and the handler found before
+         * the first of them, put back when the last one goes. */
+        struct dump_signal {
+            unsigned watchdogs {0};
+            struct sigaction previous {};
+        };
+
+        inline std::mutex dump_signals_mutex {};
+        inline dump_signal dump_signals[NSIG] {};
+
+        inline void watch_signal(int signo)
+        {
+            if (signo <= 0 || signo >= NSIG) {
+                throw std::system_error(EINVAL, std::generic_category(),
+                                        "larva::watchdog: bad signal");
+            }
+
+            std::lock_guard<std::mutex> lock(dump_signals_mutex);
+            dump_signal &d = dump_signals[signo];
+            if (d.watchdogs == 0) {
+                struct sigaction action {};
+                action.sa_handler = &request_dump;
+                action.sa_flags = SA_RESTART;
+                sigemptyset(&action.sa_mask);
+                if (sigaction(signo, &action, &d.previous) != 0) {
+                    throw std::system_error(errno, std::generic_category(),
+                                            "larva::watchdog: sigaction");
+                }
+            }
+
+            d.watchdogs++;
+        }
+
+        inline void unwatch_signal(int signo)
+        {
+            std::lock_guard<std::mutex> lock(dump_signals_mutex);
+            dump_signal &d = dump_signals[signo];
+            if (--d.watchdogs == 0) {
+                sigaction(signo, &d.previous, nullptr);
+            }
+        }
+    }
+
+    /**
+     * @brief       - Thread sampling a pool every `period`. A task running
+     *                for longer than `threshold` is reported once to
+     *                `on_stuck`, which by default writes to `std::cerr`. The
+     *                watchdog can also write `pool_state` dumps on demand or
+     *                when a signal arrives.
+     */
+    template <typename Pool>
+    class watchdog {
+    public:
+        typedef std::function<void(unsigned worker, const worker_state &)>
+            stuck_handler;
+
+    private:
+        Pool &_pool;
+        std::chrono::nanoseconds _threshold;
+        std::chrono::nanoseconds _period;
+        stuck_handler _on_stuck;
+        std::string _dump_path {};
+        int _dump_signal {0};
+        unsigned _dumps_seen {0};
+
+        bool _done {false};
+        std::mutex _mutex {};
+        std::condition_variable _cond {};
+        std::thread _thread {};
+
+    public:
+        watchdog(Pool &pool,
+                 std::chrono::nanoseconds threshold,
+                 stuck_handler on_stuck = report_to_stderr,
+                 std::chrono::nanoseconds period =
+                     std::chrono::milliseconds(100)):
+            _pool {pool}, _threshold {threshold}, _period {period},
+            _on_stuck {std::move(on_stuck)}
+        {
+            this->_pool.watch_tasks(true);
+            this->_thread = std::thread {&watchdog::run, this};
+        }
+
+        ~watchdog()
+        {
+            {
+                std::lock_guard<std::mutex> lock(this->_mutex);
+                this->_done = true;
+            }
+
+            this->_cond.notify_one();
+            this->_thread.join();
+            /* Other watchers of the pool keep it on. */
+            this->_pool.watch_tasks(false);
+            if (this->_dump_signal) {
+                detail::unwatch_signal(this->_dump_signal);
+            }
+        }
+
+        watchdog(const watchdog&) = delete;
+        watchdog& operator=(const watchdog&) = delete;
+
+        /**
+         * @brief       - Write a dump to `path`, or to `std::cerr` if empty,
+         *                whenever `signo` arrives, e.g. `SIGUSR1`, instead of
+         *                the signal's previous handler. The handler only
+         *                counts the signal; the dump is written by the
+         *                watchdog thread at its next sample. Every watchdog
+         *                on the signal dumps, and the previous handler is
+         *                put back once the last of them is destroyed. Throws
+         *                `std::system_error` if the handler can not be set.
+         */
+        void dump_on_signal(int signo, std::string path = {})
+        {
+            detail::watch_signal(signo);
+
+            std::lock_guard<std::mutex> lock(this->_mutex);
+            if (this->_dump_signal) {
+                detail::unwatch_signal(this->_dump_signal);
+            }
+
+            this->_dump_path = std::move(path);
+            this->_dump_signal = signo;
+            this->_dumps_seen = detail::dump_requests[signo].load(
+                std::memory_order_relaxed);
+        }
+
+        void dump(std::ostream &os) const
+        {
+            this->_pool.inspect().write(os);
+        }
+
+        static void report_to_stderr(unsigned worker, const worker_state &w)
+        {
+            std::cerr << "larva::watchdog: worker " << worker
+                      << " has been running '"
+                      << task_label::name_of(w.label) << "' for "
+                      << w.running_ns / 1000000 << " ms" << std::endl;
+        }
+
+    private:
+        void run()
+        {
+            /* Start time of the last task reported per worker, so a stuck
+             * task is reported once. */
+            std::vector<std::int64_t> reported(this->_pool.size(), 0);
+
+            std::unique_lock<std::mutex> lock(this->_mutex);
+            while (!this->_cond.wait_for(lock, this->_period,
+                                         [this]() { return this->_done; }))
+            {
+                /* Sample unlocked, so a handler may call back in. */
+                std::string const path = this->_dump_path;
+                bool dump_requested = false;
+                if (this->_dump_signal) {
+                    unsigned const requests =
+                        detail::dump_requests[this->_dump_signal].load(
+                            std::memory_order_relaxed);
+                    dump_requested = requests != this->_dumps_seen;
+                    this->_dumps_seen = requests;
+                }
+
+                lock.unlock();
+
+                larva::pool_state const state = this->_pool.inspect();
+                for (unsigned i = 0; i < state.workers.size(); i++) {
+                    const worker_state &w = state.workers[i];
+                    if (w.running
+                        && w.running_ns > static_cast<std::uint64_t>(
+                                              this->_threshold.count())
+                        && reported[i] != w.task_since_ns)
+                    {
+                        reported[i] = w.task_since_ns;
+                        this->_on_stuck(i, w);
+                    }
+                }
+
+                if (dump_requested) {
+                    write_dump(state, path);
+                }
+
+                lock.lock();
+            }
+        }
+
+        static void write_dump(const larva::pool_state &state,
+                               const std::string &path)
+        {
+            if (path.empty()) {
+                state.write(std::cerr);
+                return;
+            }
+
+            std::ofstream out(path, std::ios::app);
+            state.write(out ? static_cast<std::ostream &>(out) : std::cerr);
+        }
+    };
+}
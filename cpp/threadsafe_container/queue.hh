@@ -9,7 +9,7 @@ namespace larva {
     class threadsafe_queue
     {
         std::queue<T>           _queue; 
-        std::mutex              _mutex;
+        mutable std::mutex      _mutex;
         std::condition_variable _cond; 
 
     public:
@@ -40,6 +40,18 @@ namespace larva {
             return true;
         }
 
+        bool empty() const
+        {
+            std::unique_lock<std::mutex> lock(this->_mutex);
+            return this->_queue.empty();
+        }
+
+        std::size_t size() const
+        {
+            std::unique_lock<std::mutex> lock(this->_mutex);
+            return this->_queue.size();
+        }
+
         void push(T item)
         {
             std::unique_lock<std::mutex> lock(this->_mutex);
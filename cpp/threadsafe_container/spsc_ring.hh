@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace larva {
+    /**
+     * @brief       - Bounded ring buffer for exactly one producer thread and
+     *                one consumer thread, without locks. Each side owns its
+     *                index on its own cache line and keeps a cached copy of
+     *                the other one, so it only reads the shared line when the
+     *                ring looks full or empty.
+     */
+    template <typename T>
+    class spsc_ring
+    {
+        struct alignas(64) producer_side {
+            std::atomic<std::size_t> tail {0};
+            std::size_t cached_head {0};
+        };
+
+        struct alignas(64) consumer_side {
+            std::atomic<std::size_t> head {0};
+            std::size_t cached_tail {0};
+        };
+
+        struct slot {
+            alignas(T) unsigned char data[sizeof(T)];
+        };
+
+        producer_side           _producer;
+        consumer_side           _consumer;
+        std::size_t             _mask;
+        std::unique_ptr<slot[]> _slots;
+
+    public:
+        /* The capacity is rounded up to a power of two. */
+        explicit spsc_ring(std::size_t capacity)
+        {
+            std::size_t size = 1;
+            while (size < capacity) {
+                size <<= 1;
+            }
+
+            this->_mask = size - 1;
+            this->_slots = std::make_unique<slot[]>(size);
+        }
+
+        spsc_ring(const spsc_ring&) = delete;
+        spsc_ring& operator=(const spsc_ring&) = delete;
+
+        ~spsc_ring()
+        {
+            this->consume([](T&&) {}, this->capacity());
+        }
+
+        std::size_t capacity() const
+        {
+            return this->_mask + 1;
+        }
+
+        /* Producer side. */
+        bool try_push(T&& item)
+        {
+            std::size_t const tail =
+                this->_producer.tail.load(std::memory_order_relaxed);
+            if (tail - this->_producer.cached_head == this->capacity()) {
+                this->_producer.cached_head =
+                    this->_consumer.head.load(std::memory_order_acquire);
+                if (tail - this->_producer.cached_head == this->capacity()) {
+                    return false;
+                }
+            }
+
+            new (this->at(tail)) T(std::move(item));
+            this->_producer.tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief       - Consumer side. Pop up to `max` items and hand each of
+         *                them to `f`, publishing the freed slots once for the
+         *                whole batch. Returns the number of items popped.
+         */
+        template <typename F>
+        std::size_t consume(F&& f, std::size_t max)
+        {
+            std::size_t const head =
+                this->_consumer.head.load(std::memory_order_relaxed);
+            if (head == this->_consumer.cached_tail) {
+                this->_consumer.cached_tail =
+                    this->_producer.tail.load(std::memory_order_acquire);
+            }
+
+            std::size_t count = this->_consumer.cached_tail - head;
+            if (count > max) {
+                count = max;
+            }
+
+            for (std::size_t i = 0; i < count; i++) {
+                T *item = std::launder(reinterpret_cast<T *>(this->at(head + i)));
+                f(std::move(*item));
+                item->~T();
+            }
+
+            if (count) {
+                this->_consumer.head.store(head + count,
+                                           std::memory_order_release);
+            }
+
+            return count;
+        }
+
+        /* Either side, or anyone as a hint. */
+        bool empty() const
+        {
+            return this->_consumer.head.load(std::memory_order_acquire)
+                    == this->_producer.tail.load(std::memory_order_acquire);
+        }
+
+    private:
+        void *at(std::size_t index)
+        {
+            return this->_slots[index & this->_mask].data;
+        }
+    };
+}
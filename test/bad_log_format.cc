@@ -0,0 +1,20 @@
+/* Must not compile: built, and expected to fail, by the bad_log_format_*
+ * tests. */
+/* Formats of statements compiled out are checked all the same. */
+#if defined(BAD_DISCARDED)
+#define LARVA_LOG_MIN_LEVEL 1
+#endif
+
+#include <logger/logger.hh>
+
+int main()
+{
+#if defined(BAD_ARITY)
+    log_info("{} and {}", 1);
+#elif defined(BAD_BRACE)
+    log_info("unmatched { brace", 1);
+#elif defined(BAD_DISCARDED)
+    log_debug("{} and {}", 1);
+#endif
+    return 0;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <iostream>
+
+/* Report a failed expectation and go on, so one run shows every failure.
+ * `main()` returns `larva_test::failures != 0`. */
+namespace larva_test {
+    inline int failures = 0;
+}
+
+#define CHECK(condition)                                                    \
+    do {                                                                    \
+        if (!(condition)) {                                                 \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK("          \
+                      << #condition << ") failed\n";                        \
+            larva_test::failures++;                                         \
+        }                                                                   \
+    } while (0)
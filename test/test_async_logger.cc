@@ -0,0 +1,115 @@
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <logger/logger.hh>
+
+#include "check.hh"
+
+namespace {
+
+    /* A temporary file, removed with the object. */
+    struct temp_file {
+        char path[32] = "/tmp/larva_testXXXXXX";
+        int fd {::mkstemp(path)};
+
+        ~temp_file()
+        {
+            ::close(this->fd);
+            ::unlink(this->path);
+        }
+
+        std::vector<std::string> lines() const
+        {
+            std::ifstream in(this->path);
+            std::vector<std::string> out;
+            for (std::string line; std::getline(in, line);) {
+                out.push_back(line);
+            }
+
+            return out;
+        }
+    };
+
+    /* Every line is whole and each thread's lines stay in order. */
+    void stop_writes_everything_queued()
+    {
+        constexpr int threads = 4;
+        constexpr int per_thread = 5000;
+        temp_file file;
+        larva::logger::start_async(file.fd);
+        std::vector<std::thread> loggers;
+        for (int t = 0; t < threads; t++) {
+            loggers.emplace_back([t] {
+                for (int i = 0; i < per_thread; i++) {
+                    info() << "thread " << t << " line " << i;
+                }
+            });
+        }
+
+        for (std::thread &l: loggers) {
+            l.join();
+        }
+
+        larva::logger::stop_async();
+
+        std::vector<int> next(threads, 0);
+        std::vector<std::string> const lines = file.lines();
+        CHECK(lines.size() == threads * per_thread);
+        for (const std::string &line: lines) {
+            std::size_t const at = line.find("(): thread ");
+            int t = -1, i = -1;
+            CHECK(at != std::string::npos
+                  && std::sscanf(line.c_str() + at, "(): thread %d line %d",
+                                 &t, &i) == 2);
+            if (t >= 0 && t < threads) {
+                CHECK(i == next[t]);
+                next[t] = i + 1;
+            }
+        }
+    }
+
+    /* Records written while the writer stops are never left behind. */
+    void writes_racing_stop_are_kept()
+    {
+        temp_file file;
+        larva::log_writer &writer = larva::log_writer::instance();
+        long total = 0;
+        for (int round = 0; round < 100; round++) {
+            writer.start(file.fd);
+            std::atomic<long> written {0};
+            std::vector<std::thread> loggers;
+            for (int t = 0; t < 3; t++) {
+                loggers.emplace_back([&writer, &written] {
+                    for (int i = 0; i < 200; i++) {
+                        writer.write("x", "\n");
+                        written++;
+                    }
+                });
+            }
+
+            std::this_thread::yield();
+            writer.stop();
+            for (std::thread &l: loggers) {
+                l.join();
+            }
+
+            total += written;
+            CHECK(::lseek(file.fd, 0, SEEK_END) == 2 * total);
+        }
+    }
+}
+
+int main()
+{
+    stop_writes_everything_queued();
+    writes_racing_stop_are_kept();
+    return larva_test::failures != 0;
+}
@@ -0,0 +1,143 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <logger/logger.hh>
+
+#include "check.hh"
+
+/**
+ * Logs the same statements through the deferred logger in text and in
+ * binary mode, and checks that the binary log decodes, with the decoder
+ * given as argument, into the same text.
+ */
+namespace {
+
+    struct temp_file {
+        char path[32] = "/tmp/larva_testXXXXXX";
+        int fd {::mkstemp(path)};
+
+        ~temp_file()
+        {
+            ::close(this->fd);
+            ::unlink(this->path);
+        }
+
+        std::string contents() const
+        {
+            std::ifstream in(this->path, std::ios::binary);
+            return {std::istreambuf_iterator<char>(in), {}};
+        }
+    };
+
+    std::string run(const std::string &command, int &status)
+    {
+        std::string out;
+        FILE *p = ::popen(command.c_str(), "r");
+        if (!p) {
+            status = -1;
+            return out;
+        }
+
+        char buffer[4096];
+        std::size_t n;
+        while ((n = std::fread(buffer, 1, sizeof(buffer), p)) > 0) {
+            out.append(buffer, n);
+        }
+
+        status = ::pclose(p);
+        return out;
+    }
+
+    /* Every kind of argument, through both kinds of statement. */
+    void statements(int round)
+    {
+        std::string const name = "user";
+        const char *missing = nullptr;
+        info() << "round " << round << " of " << 3u << ", ok " << true
+               << ", ratio " << 0.125 << ", char " << 'c';
+        warn() << name << " " << missing << " " << std::int64_t {-1} << " "
+               << ~std::uint64_t {0} << " " << nullptr;
+        log_error("{} took {} ms, {{literal}} {}", name, round * 1.5, 'z');
+        log_info("no arguments at all");
+        log_debug("{}", std::string(300, 'x'));
+    }
+
+    void logged(const temp_file &file, larva::logger::output output)
+    {
+        larva::logger::start_deferred(file.fd, output);
+        for (int round = 0; round < 3; round++) {
+            statements(round);
+        }
+
+        larva::logger::stop_deferred();
+    }
+
+    void records_round_trip()
+    {
+        larva::log_buffer record;
+        larva::binary_log::begin(record, 7, 42);
+        larva::binary_log::encode(record, -5);
+        larva::binary_log::encode(record, 2.5f);
+        larva::binary_log::encode(record, std::string("text"));
+        larva::binary_log::encode(record, false);
+        std::string_view const view = larva::binary_log::finish(record);
+
+        std::uint32_t size;
+        std::memcpy(&size, view.data(), sizeof(size));
+        CHECK(size == view.size());
+
+        std::string text;
+        larva::binary_log::reader r(
+            view.data() + larva::binary_log::header_size,
+            view.size() - larva::binary_log::header_size);
+        CHECK(larva::binary_log::format_arguments(r, text));
+        CHECK(text == "-52.5textfalse");
+
+        /* Cut short: malformed, not read past the end. */
+        larva::binary_log::reader cut(
+            view.data() + larva::binary_log::header_size, 5);
+        text.clear();
+        CHECK(!larva::binary_log::format_arguments(cut, text));
+    }
+
+    void decoder_matches_text_mode(const std::string &decoder)
+    {
+        temp_file text;
+        temp_file binary;
+        logged(text, larva::logger::output::text);
+        logged(binary, larva::logger::output::binary);
+
+        std::string const log = binary.contents();
+        CHECK(log.compare(0, sizeof(larva::binary_log::magic),
+                          larva::binary_log::magic,
+                          sizeof(larva::binary_log::magic)) == 0);
+
+        int status;
+        std::string const decoded = run(decoder + " " + binary.path, status);
+        CHECK(status == 0);
+        CHECK(decoded == text.contents());
+        CHECK(decoded.find("] ") != std::string::npos);
+
+        /* A truncated log is refused. */
+        CHECK(::ftruncate(binary.fd, static_cast<off_t>(log.size() - 3)) == 0);
+        run(decoder + " " + binary.path + " 2>/dev/null", status);
+        CHECK(status != 0);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    records_round_trip();
+    if (argc > 1) {
+        decoder_matches_text_mode(argv[1]);
+    }
+
+    return larva_test::failures != 0;
+}
@@ -0,0 +1,90 @@
+#include <chrono>
+#include <future>
+#include <thread>
+
+#include <thread_pool/thread_pool.hh>
+#include <thread_pool/task_label.hh>
+
+#include "check.hh"
+
+namespace {
+
+    void burn(std::chrono::milliseconds duration)
+    {
+        auto const end = std::chrono::steady_clock::now() + duration;
+        while (std::chrono::steady_clock::now() < end) {
+        }
+    }
+
+    void labels_are_interned()
+    {
+        larva::task_label const a("test.interned");
+        larva::task_label const b("test.interned");
+        CHECK(a.id() == b.id());
+        CHECK(a.id() != larva::task_label().id());
+        CHECK(a.name() == "test.interned");
+        CHECK(larva::task_label::name_of(0) == "unlabeled");
+    }
+
+    void each_label_pays_for_its_tasks()
+    {
+        larva::task_label const busy("test.busy");
+        larva::task_label const idle("test.idle");
+        larva::thread_pool pool(1);
+        pool.record_usage(true);
+        for (int i = 0; i < 4; i++) {
+            pool.submit(busy, [] { burn(std::chrono::milliseconds(5)); });
+            pool.submit(idle, [] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            });
+        }
+
+        pool.submit([] {});
+        pool.wait_idle();
+        pool.record_usage(false);
+        pool.submit(busy, [] {});
+        pool.wait_idle();
+
+        auto const usage = pool.usage();
+        CHECK(usage[busy.id()].tasks == 4);
+        CHECK(usage[idle.id()].tasks == 4);
+        CHECK(usage[0].tasks == 1);
+        CHECK(usage[idle.id()].wall_ns >= 20000000u);
+        CHECK(usage[idle.id()].cpu_ns < usage[idle.id()].wall_ns / 2);
+        CHECK(usage[busy.id()].cpu_ns > usage[idle.id()].cpu_ns);
+    }
+
+    /* A task run while another waits is charged to its own label only. */
+    void inline_tasks_are_not_charged_twice()
+    {
+        larva::task_label const outer("test.outer");
+        larva::task_label const inner("test.inner");
+        larva::thread_pool pool(1);
+        pool.record_usage(true);
+        pool.submit(outer, [&pool, &inner] {
+            std::future<void> f = pool.submit(inner, [] {
+                burn(std::chrono::milliseconds(20));
+            });
+
+            while (f.wait_for(std::chrono::seconds(0))
+                   != std::future_status::ready) {
+                pool.run_pending_task();
+            }
+        }).get();
+        pool.wait_idle();
+
+        auto const usage = pool.usage();
+        CHECK(usage[outer.id()].tasks == 1);
+        CHECK(usage[inner.id()].tasks == 1);
+        CHECK(usage[inner.id()].wall_ns >= 20000000u);
+        CHECK(usage[outer.id()].wall_ns < usage[inner.id()].wall_ns / 2);
+    }
+}
+
+int main()
+{
+    labels_are_interned();
+    each_label_pays_for_its_tasks();
+    inline_tasks_are_not_charged_twice();
+    return larva_test::failures != 0;
+}
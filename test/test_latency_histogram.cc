@@ -0,0 +1,143 @@
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <thread_pool/latency_histogram.hh>
+
+#include "check.hh"
+
+namespace {
+
+    typedef larva::histogram_snapshot snapshot;
+
+    /* Buckets tile the values: each one starts right after the previous
+     * bound and is at most 1/32 of its values wide. */
+    void buckets_tile_the_values()
+    {
+        for (std::uint64_t v = 0; v < snapshot::sub_count; v++) {
+            CHECK(snapshot::index_of(v) == v);
+            CHECK(snapshot::upper_bound_of(static_cast<unsigned>(v)) == v);
+        }
+
+        for (unsigned i = 0; i + 1 < snapshot::bucket_count; i++) {
+            std::uint64_t const bound = snapshot::upper_bound_of(i);
+            CHECK(snapshot::index_of(bound) == i);
+            CHECK(snapshot::index_of(bound + 1) == i + 1);
+            if (i >= snapshot::sub_count) {
+                std::uint64_t const width =
+                    bound - snapshot::upper_bound_of(i - 1);
+                CHECK(width <= bound / snapshot::sub_count + 1);
+            }
+        }
+
+        CHECK(snapshot::index_of(~std::uint64_t {0})
+              == snapshot::bucket_count - 1);
+        CHECK(snapshot::upper_bound_of(snapshot::bucket_count - 1)
+              == ~std::uint64_t {0});
+    }
+
+    void percentiles_are_bucket_bounds()
+    {
+        larva::latency_histogram h;
+        for (std::uint64_t v = 1; v <= 1000; v++) {
+            h.record(v);
+        }
+
+        snapshot const s = h.snapshot();
+        CHECK(s.count() == 1000);
+        CHECK(s.max() == 1000);
+        CHECK(s.mean() == 500.5);
+
+        /* The 500th value is 500; its bucket, 496 to 503, reports 503. */
+        CHECK(snapshot::index_of(500) == snapshot::index_of(503));
+        CHECK(s.percentile(0.5) == 503);
+        CHECK(s.percentile(0.0) == 1);
+        CHECK(s.percentile(1.0) == 1000);
+
+        /* Clamped to the largest value seen. */
+        CHECK(s.percentile(0.999) == 1000);
+        CHECK(snapshot {}.percentile(0.5) == 0);
+
+        larva::latency_summary const summary = larva::latency_summary::of(s);
+        CHECK(summary.count == 1000);
+        CHECK(summary.p50 <= summary.p99);
+        CHECK(summary.p99 <= summary.p999);
+        CHECK(summary.p999 <= summary.max);
+    }
+
+    /* Ranks round up: a percentile never lands below its share. */
+    void small_sets_round_the_rank_up()
+    {
+        larva::latency_histogram three;
+        for (std::uint64_t v = 1; v <= 3; v++) {
+            three.record(v);
+        }
+
+        snapshot const s = three.snapshot();
+        CHECK(s.percentile(0.5) == 2);
+        CHECK(s.percentile(0.34) == 2);
+        CHECK(s.percentile(0.33) == 1);
+        CHECK(s.percentile(0.9) == 3);
+
+        larva::latency_histogram hundred;
+        for (std::uint64_t v = 1; v <= 100; v++) {
+            hundred.record(v);
+        }
+
+        CHECK(hundred.snapshot().percentile(0.999) == 100);
+        CHECK(hundred.snapshot().percentile(0.99) == 99);
+        CHECK(hundred.snapshot().percentile(0.07) == 7);
+    }
+
+    void snapshots_merge()
+    {
+        larva::latency_histogram small;
+        larva::latency_histogram large;
+        small.record(3);
+        small.record(3);
+        large.record(1 << 20);
+
+        snapshot merged = small.snapshot();
+        merged += large.snapshot();
+        CHECK(merged.count() == 3);
+        CHECK(merged.count_at(3) == 2);
+        CHECK(merged.count_at(snapshot::index_of(1 << 20)) == 1);
+        CHECK(merged.max() == 1 << 20);
+        CHECK(merged.percentile(0.5) == 3);
+        CHECK(merged.percentile(1.0) == 1 << 20);
+    }
+
+    void shared_records_are_not_lost()
+    {
+        constexpr int threads = 4;
+        constexpr std::uint64_t per_thread = 20000;
+        larva::latency_histogram h;
+        std::vector<std::thread> writers;
+        for (int t = 0; t < threads; t++) {
+            writers.emplace_back([&h, t] {
+                for (std::uint64_t v = 0; v < per_thread; v++) {
+                    h.record_shared(v * threads + t);
+                }
+            });
+        }
+
+        for (std::thread &w: writers) {
+            w.join();
+        }
+
+        snapshot const s = h.snapshot();
+        CHECK(s.count() == threads * per_thread);
+        CHECK(s.max() == threads * per_thread - 1);
+        CHECK(s.mean() == (threads * per_thread - 1) / 2.0);
+    }
+}
+
+int main()
+{
+    buckets_tile_the_values();
+    percentiles_are_bucket_bounds();
+    small_sets_round_the_rank_up();
+    snapshots_merge();
+    shared_records_are_not_lost();
+    return larva_test::failures != 0;
+}
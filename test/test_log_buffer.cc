@@ -0,0 +1,153 @@
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <sstream>
+#include <string>
+
+#include <logger/log_buffer.hh>
+
+#include "check.hh"
+
+namespace {
+
+    template <typename T>
+    std::string formatted(const T &value)
+    {
+        larva::log_buffer out;
+        larva::format_to(out, value);
+        return std::string(out.view());
+    }
+
+    template <typename T>
+    std::string streamed(const T &value)
+    {
+        std::ostringstream text;
+        text << std::boolalpha << value;
+        return text.str();
+    }
+
+    template <typename T>
+    bool as_streamed(const T &value)
+    {
+        return formatted(value) == streamed(value);
+    }
+
+    void numbers_print_as_streams_do()
+    {
+        for (double d: {0.0, -0.0, 1.0, -2.5, 0.1, 1.0 / 3, 123456.0,
+                        1234567.0, 0.0001, 0.00001234, 1e100, -1e-300,
+                        3.14159265358979,
+                        std::numeric_limits<double>::max(),
+                        std::numeric_limits<double>::min(),
+                        std::numeric_limits<double>::infinity(),
+                        -std::numeric_limits<double>::infinity()})
+        {
+            CHECK(as_streamed(d));
+            CHECK(as_streamed(static_cast<float>(d)));
+        }
+
+        CHECK(formatted(1.0 / 3) == "0.333333");
+        CHECK(formatted(1234567.0) == "1.23457e+06");
+        CHECK(formatted(std::nan("")) == "nan");
+
+        CHECK(as_streamed(0));
+        CHECK(as_streamed(-42));
+        CHECK(as_streamed(std::numeric_limits<std::int64_t>::min()));
+        CHECK(as_streamed(std::numeric_limits<std::uint64_t>::max()));
+        CHECK(as_streamed(static_cast<short>(-7)));
+        CHECK(as_streamed('x'));
+        CHECK(formatted(static_cast<unsigned char>('y')) == "y");
+    }
+
+    void bools_print_as_words()
+    {
+        CHECK(formatted(true) == "true");
+        CHECK(formatted(false) == "false");
+    }
+
+    void pointers_print_in_hex()
+    {
+        int i = 0;
+        const void *const p = &i;
+        CHECK(formatted(&i) == streamed(p));
+        CHECK(formatted(p).rfind("0x", 0) == 0);
+        CHECK(formatted(reinterpret_cast<const void *>(0xbeef)) == "0xbeef");
+        CHECK(formatted(static_cast<const int *>(nullptr)) == "0");
+        CHECK(formatted(static_cast<void *>(nullptr)) == "0");
+        CHECK(formatted(nullptr) == "nullptr");
+    }
+
+    void strings_are_copied()
+    {
+        const char *const null = nullptr;
+        CHECK(formatted("text") == "text");
+        CHECK(formatted(std::string("string")) == "string");
+        CHECK(formatted(std::string_view("view")) == "view");
+        CHECK(formatted(null) == "(null)");
+    }
+
+    /* A line over the inline capacity moves to the buffer kept by the
+     * thread, and the next long line reuses it. */
+    void long_lines_reuse_the_thread_buffer()
+    {
+        std::string const line(3 * larva::log_buffer::inline_capacity, 'a');
+        const char *spilled = nullptr;
+        {
+            larva::log_buffer out;
+            out.append(line.substr(0, larva::log_buffer::inline_capacity));
+            const char *const inline_data = out.data();
+            CHECK(out.size() == larva::log_buffer::inline_capacity);
+
+            out.append(line.substr(larva::log_buffer::inline_capacity));
+            spilled = out.data();
+            CHECK(spilled != inline_data);
+            CHECK(out.view() == line);
+        }
+
+        larva::log_buffer again;
+        again.append(line);
+        CHECK(again.data() == spilled);
+        CHECK(again.view() == line);
+    }
+
+    /* While one record holds the thread buffer, another gets its own, and
+     * the thread buffer is free again once the first is done. */
+    void nested_lines_get_their_own_buffer()
+    {
+        std::string const outer(1000, 'o');
+        std::string const inner(1000, 'i');
+        const char *shared = nullptr;
+        {
+            larva::log_buffer first;
+            first.append(outer);
+            shared = first.data();
+            {
+                larva::log_buffer second;
+                second.append(inner);
+                CHECK(second.data() != shared);
+                CHECK(second.view() == inner);
+
+                second.append(inner);
+                CHECK(second.view() == inner + inner);
+            }
+
+            CHECK(first.view() == outer);
+        }
+
+        larva::log_buffer third;
+        third.append(outer);
+        CHECK(third.data() == shared);
+        CHECK(third.view() == outer);
+    }
+}
+
+int main()
+{
+    numbers_print_as_streams_do();
+    bools_print_as_words();
+    pointers_print_in_hex();
+    strings_are_copied();
+    long_lines_reuse_the_thread_buffer();
+    nested_lines_get_their_own_buffer();
+    return larva_test::failures != 0;
+}
@@ -0,0 +1,92 @@
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <logger/logger.hh>
+
+#include "check.hh"
+
+namespace {
+
+    /* Parsed at compile time. */
+    constexpr larva::log_format<larva::parse_format("id {}: {{{}}}")> parsed {
+        "id {}: {{{}}}"};
+    static_assert(parsed.arity == 2, "two {} in the format");
+    static_assert(larva::parse_format("") == 0, "no segment at all");
+    static_assert(larva::parse_format("{}") == 1, "one argument");
+
+    bool refused(std::string_view format)
+    {
+        try {
+            larva::parse_format(format);
+        } catch (const std::invalid_argument &) {
+            return true;
+        }
+
+        return false;
+    }
+
+    void segments_split_the_format()
+    {
+        larva::format_segment segments[8];
+        std::size_t const count =
+            larva::parse_format("a{}b {{c}} {}", segments);
+        CHECK(count == 6);
+        CHECK(segments[0].text == "a" && !segments[0].argument);
+        CHECK(segments[1].argument);
+        CHECK(segments[2].text == "b {" && !segments[2].argument);
+        CHECK(segments[3].text == "c}" && !segments[3].argument);
+        CHECK(segments[4].text == " " && !segments[4].argument);
+        CHECK(segments[5].argument);
+
+        CHECK(parsed.segments[0].text == "id ");
+        CHECK(parsed.segments[1].argument);
+        CHECK(parsed.segments[2].text == ": {");
+        CHECK(parsed.segments[3].argument);
+        CHECK(parsed.segments[4].text == "}");
+    }
+
+    void unmatched_braces_throw()
+    {
+        CHECK(refused("{"));
+        CHECK(refused("}"));
+        CHECK(refused("a { b"));
+        CHECK(refused("{x}"));
+        CHECK(refused("{}}"));
+        CHECK(refused("text }"));
+        CHECK(!refused("{{}}"));
+        CHECK(!refused("{}{}"));
+    }
+
+    /* What the formatted statements write, through the async writer. */
+    void statements_format_their_arguments()
+    {
+        char path[] = "/tmp/larva_testXXXXXX";
+        int const fd = ::mkstemp(path);
+        larva::logger::start_async(fd);
+        log_warn("user {} took {} ms, {{ok}}", 7, 1.5);
+        log_info("{}{}", "a", 'b');
+        larva::logger::stop_async();
+
+        char buffer[512];
+        ssize_t const n = ::pread(fd, buffer, sizeof(buffer), 0);
+        std::string const out(buffer, n > 0 ? static_cast<std::size_t>(n) : 0);
+        ::close(fd);
+        ::unlink(path);
+
+        CHECK(out.find("user 7 took 1.5 ms, {ok}\n") != std::string::npos);
+        CHECK(out.find("(): ab\n") != std::string::npos);
+        CHECK(out.find("[WARN]") == 0);
+    }
+}
+
+int main()
+{
+    segments_split_the_format();
+    unmatched_braces_throw();
+    statements_format_their_arguments();
+    return larva_test::failures != 0;
+}
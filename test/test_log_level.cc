@@ -0,0 +1,110 @@
+/* Built twice: as is, and with LARVA_LOG_MIN_LEVEL=2, which compiles out
+ * debug and info statements. */
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <logger/logger.hh>
+
+#include "check.hh"
+
+namespace {
+
+    /* A temporary file, removed with the object. */
+    struct temp_file {
+        char path[32] = "/tmp/larva_testXXXXXX";
+        int fd {::mkstemp(path)};
+
+        ~temp_file()
+        {
+            ::close(this->fd);
+            ::unlink(this->path);
+        }
+
+        std::vector<std::string> lines() const
+        {
+            std::ifstream in(this->path);
+            std::vector<std::string> out;
+            for (std::string line; std::getline(in, line);) {
+                out.push_back(line);
+            }
+
+            return out;
+        }
+    };
+
+    int evaluated = 0;
+
+    /* A `<<` argument that counts its evaluations. */
+    int argument()
+    {
+        return ++evaluated;
+    }
+
+    /* Each statement at every level, with an argument that counts. */
+    std::vector<std::string> log_each_level()
+    {
+        temp_file file;
+        larva::logger::start_async(file.fd);
+        debug() << "debug " << argument();
+        info() << "info " << argument();
+        warn() << "warn " << argument();
+        error() << "error " << argument();
+        log_debug("log_debug {}", argument());
+        log_info("log_info {}", argument());
+        log_warn("log_warn {}", argument());
+        log_error("log_error {}", argument());
+        larva::logger::stop_async();
+        return file.lines();
+    }
+
+    bool ends_with(const std::string &line, const std::string &end)
+    {
+        return line.size() >= end.size()
+               && line.compare(line.size() - end.size(), end.size(), end) == 0;
+    }
+
+    void below_the_threshold_nothing_is_evaluated()
+    {
+        larva::logger::set_level(larva::logger::level::error);
+        evaluated = 0;
+        std::vector<std::string> const lines = log_each_level();
+        larva::logger::set_level(larva::logger::level::debug);
+
+        CHECK(evaluated == 2);
+        CHECK(lines.size() == 2);
+        CHECK(lines.size() == 2 && ends_with(lines[0], "error 1")
+              && ends_with(lines[1], "log_error 2"));
+    }
+
+    void below_the_minimum_level_nothing_is_written()
+    {
+        evaluated = 0;
+        std::vector<std::string> const lines = log_each_level();
+
+#if LARVA_LOG_MIN_LEVEL == 2
+        std::vector<std::string> const expected {
+            "warn 1", "error 2", "log_warn 3", "log_error 4"};
+#else
+        std::vector<std::string> const expected {
+            "debug 1", "info 2", "warn 3", "error 4",
+            "log_debug 5", "log_info 6", "log_warn 7", "log_error 8"};
+#endif
+
+        CHECK(evaluated == static_cast<int>(expected.size()));
+        CHECK(lines.size() == expected.size());
+        for (std::size_t i = 0; i < lines.size() && i < expected.size(); i++) {
+            CHECK(ends_with(lines[i], expected[i]));
+        }
+    }
+}
+
+int main()
+{
+    below_the_threshold_nothing_is_evaluated();
+    below_the_minimum_level_nothing_is_written();
+    return larva_test::failures != 0;
+}
@@ -0,0 +1,90 @@
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <thread_pool/per_core_executor.hh>
+
+#include "check.hh"
+
+namespace {
+
+    void tasks_run_on_their_core()
+    {
+        larva::per_core_executor ex(2);
+        CHECK(ex.current_core() == -1);
+        CHECK(ex.submit_to(1, [&ex] { return ex.current_core(); }).get() == 1);
+        CHECK(ex.submit_to(1, [&ex] {
+                  return ex.submit([&ex] { return ex.current_core(); });
+              }).get().get() == 1);
+
+        bool refused = false;
+        try {
+            ex.submit_to(2, [] {});
+        } catch (const std::out_of_range &) {
+            refused = true;
+        }
+
+        CHECK(refused);
+    }
+
+    /* Other threads spread their tasks over the cores in turn. */
+    void outside_submits_take_turns()
+    {
+        larva::per_core_executor ex(3);
+        std::vector<int> cores;
+        for (int i = 0; i < 6; i++) {
+            cores.push_back(ex.submit([&ex] { return ex.current_core(); }).get());
+        }
+
+        CHECK((cores == std::vector<int> {0, 1, 2, 0, 1, 2}));
+    }
+
+    /**
+     * Core 1 is held by a task until core 0 runs its own work. Core 0 then
+     * sends more than a ring holds to core 1: the ring fills, and core 0
+     * must run its own queue, which lets core 1 go, to get room.
+     */
+    void full_ring_runs_own_work()
+    {
+        constexpr int count = 100;
+        std::atomic<bool> gate {false};
+        std::vector<int> order;
+        int sent = 0;
+        int sent_when_opened = -1;
+        {
+            larva::per_core_executor ex(2, 4);
+            ex.submit_to(0, [&] {
+                ex.submit_to(1, [&gate] {
+                    while (!gate) {
+                        std::this_thread::yield();
+                    }
+                });
+
+                ex.submit_to(0, [&] {
+                    sent_when_opened = sent;
+                    gate = true;
+                });
+
+                for (; sent < count; sent++) {
+                    ex.submit_to(1, [&order, i = sent] { order.push_back(i); });
+                }
+            });
+        }
+
+        CHECK(sent_when_opened >= 0);
+        CHECK(sent_when_opened < count);
+        CHECK(static_cast<int>(order.size()) == count);
+        for (int i = 0; i < static_cast<int>(order.size()); i++) {
+            CHECK(order[i] == i);
+        }
+    }
+}
+
+int main()
+{
+    tasks_run_on_their_core();
+    outside_submits_take_turns();
+    full_ring_runs_own_work();
+    return larva_test::failures != 0;
+}
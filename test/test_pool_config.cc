@@ -0,0 +1,113 @@
+#include <fstream>
+#include <string>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <thread_pool/pool_config.hh>
+
+#include "check.hh"
+
+namespace {
+
+    /* A temporary file, removed with the object. */
+    struct temp_file {
+        char path[32] = "/tmp/larva_testXXXXXX";
+        int fd {::mkstemp(path)};
+
+        ~temp_file()
+        {
+            ::close(this->fd);
+            ::unlink(this->path);
+        }
+
+        void write(const std::string &text) const
+        {
+            std::ofstream(this->path) << text;
+        }
+    };
+
+    std::string this_host()
+    {
+        return "host = " + larva::pool_config::host() + "\n";
+    }
+
+    /* Loads `text` into a config with known values, which a refused file
+     * must leave alone. */
+    bool loads(const std::string &text)
+    {
+        temp_file file;
+        file.write(text);
+        larva::pool_config c;
+        c.threads = 3;
+        c.spin_count = 5;
+        bool const loaded = c.load(file.path);
+        CHECK(loaded || (c.threads == 3 && c.spin_count == 5));
+        return loaded;
+    }
+
+    void saved_configs_load_back()
+    {
+        temp_file file;
+        larva::pool_config saved;
+        saved.threads = 7;
+        saved.spin_count = 1000;
+        CHECK(saved.save(file.path));
+
+        larva::pool_config loaded;
+        CHECK(loaded.load(file.path));
+        CHECK(loaded.threads == 7);
+        CHECK(loaded.spin_count == 1000);
+    }
+
+    void valid_files_load()
+    {
+        CHECK(loads(this_host() + "threads = 2\nspin_count = 0\n"));
+        CHECK(loads("\n" + this_host() + "  \nspin_count = 9\nthreads = 1"));
+    }
+
+    void malformed_files_are_refused()
+    {
+        std::string const host = this_host();
+        std::string const spin = "spin_count = 64\n";
+
+        /* Unknown key. */
+        CHECK(!loads(host + "threads = 2\n" + spin + "queue = 8\n"));
+        /* Not a number. */
+        CHECK(!loads(host + "threads = two\n" + spin));
+        CHECK(!loads(host + "threads = 2x\n" + spin));
+        CHECK(!loads(host + "threads = -2\n" + spin));
+        /* Out of range for an unsigned. */
+        CHECK(!loads(host + "threads = 2\nspin_count = 99999999999\n"));
+        /* No workers. */
+        CHECK(!loads(host + "threads = 0\n" + spin));
+        /* A key missing, as in a file cut short. */
+        CHECK(!loads(host + "threads = 2\n"));
+        CHECK(!loads(host + "threads = 2\nspin_co"));
+        CHECK(!loads("threads = 2\n" + spin));
+        CHECK(!loads(""));
+        /* Lines that are not `key = value`. */
+        CHECK(!loads(host + "threads 2\n" + spin));
+        CHECK(!loads(host + "threads =\n" + spin));
+        CHECK(!loads(host + "threads = 2 4\n" + spin));
+        CHECK(!loads(host + "threads : 2\n" + spin));
+        /* Tuned on another host. */
+        CHECK(!loads("host = not-" + larva::pool_config::host()
+                     + "\nthreads = 2\n" + spin));
+    }
+
+    void missing_files_are_refused()
+    {
+        larva::pool_config c;
+        CHECK(!c.load("/nonexistent/larva_pool.conf"));
+    }
+}
+
+int main()
+{
+    saved_configs_load_back();
+    valid_files_load();
+    malformed_files_are_refused();
+    missing_files_are_refused();
+    return larva_test::failures != 0;
+}
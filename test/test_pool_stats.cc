@@ -0,0 +1,102 @@
+#include <atomic>
+#include <future>
+#include <thread>
+
+#include <thread_pool/thread_pool.hh>
+#include <thread_pool/stealing_thread_pool.hh>
+
+#include "check.hh"
+
+namespace {
+
+    /* Tasks from outside go through the shared queue, their children
+     * through the worker's own. */
+    void counts_are_exact_once_idle()
+    {
+        constexpr int outer = 300;
+        larva::thread_pool pool(2);
+        pool.record_latency(true);
+        for (int round = 1; round <= 5; round++) {
+            for (int i = 0; i < outer; i++) {
+                pool.submit([&pool] { pool.submit([] {}); });
+            }
+
+            pool.wait_idle();
+            larva::worker_stats const total = pool.stats().total();
+            CHECK(total.tasks_executed == 2u * outer * round);
+            CHECK(total.global_pops == 1u * outer * round);
+            CHECK(total.local_pops == 1u * outer * round);
+            CHECK(total.steals == 0);
+
+            larva::pool_latency const latency = pool.latency();
+            CHECK(latency.queue_wait.count() == 2u * outer * round);
+            CHECK(latency.execution.count() == 2u * outer * round);
+        }
+
+        CHECK(pool.stats().workers.size() == 2);
+        CHECK(pool.stats().external.tasks_executed == 0);
+    }
+
+    void every_pop_is_accounted_for()
+    {
+        larva::stealing_thread_pool pool(3);
+        std::atomic<int> ran {0};
+        for (int i = 0; i < 100; i++) {
+            pool.submit([&pool, &ran] {
+                for (int j = 0; j < 10; j++) {
+                    pool.submit([&ran] { ran++; });
+                }
+            });
+        }
+
+        pool.wait_idle();
+        larva::worker_stats const total = pool.stats().total();
+        CHECK(ran == 1000);
+        CHECK(total.tasks_executed == 1100);
+        CHECK(total.local_pops + total.global_pops + total.steals == 1100);
+        CHECK(total.global_pops == 100);
+    }
+
+    /* A thread waiting on the pool runs a task itself. */
+    void external_runs_are_counted_apart()
+    {
+        larva::thread_pool pool(1);
+        std::atomic<bool> gate {false};
+        std::atomic<bool> blocked {false};
+        std::future<void> blocker = pool.submit([&gate, &blocked] {
+            blocked = true;
+            while (!gate) {
+                std::this_thread::yield();
+            }
+        });
+
+        /* Or this thread could pick the blocker up itself. */
+        while (!blocked) {
+            std::this_thread::yield();
+        }
+
+        std::atomic<bool> ran {false};
+        std::future<void> mine = pool.submit([&ran] { ran = true; });
+        while (!ran) {
+            pool.run_pending_task();
+        }
+
+        gate = true;
+        blocker.get();
+        mine.get();
+        pool.wait_idle();
+
+        larva::pool_stats const s = pool.stats();
+        CHECK(s.external.tasks_executed == 1);
+        CHECK(s.workers[0].tasks_executed == 1);
+        CHECK(s.external.tasks_executed == s.external.global_pops);
+    }
+}
+
+int main()
+{
+    counts_are_exact_once_idle();
+    every_pop_is_accounted_for();
+    external_runs_are_counted_apart();
+    return larva_test::failures != 0;
+}
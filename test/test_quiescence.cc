@@ -0,0 +1,93 @@
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+
+#include <thread_pool/stealing_thread_pool.hh>
+#include <thread_pool/quiescence.hh>
+
+#include "check.hh"
+
+namespace {
+
+    /* Each task submits two children until `depth` runs out. */
+    void fan_out(larva::stealing_thread_pool &pool,
+                 std::atomic<int> &ran,
+                 int depth)
+    {
+        ran++;
+        if (depth > 0) {
+            for (int i = 0; i < 2; i++) {
+                pool.submit([&pool, &ran, depth] {
+                    fan_out(pool, ran, depth - 1);
+                });
+            }
+        }
+    }
+
+    void wait_idle_waits_for_nested_tasks()
+    {
+        std::atomic<int> ran {0};
+        larva::stealing_thread_pool pool(2);
+        for (int round = 1; round <= 3; round++) {
+            pool.submit([&pool, &ran] { fan_out(pool, ran, 6); });
+            pool.wait_idle();
+            CHECK(ran == round * 127);
+        }
+
+        /* Same for a barrier: the children join their parent's epoch. */
+        pool.submit([&pool, &ran] { fan_out(pool, ran, 6); });
+        pool.barrier();
+        CHECK(ran == 4 * 127);
+    }
+
+    bool finishes_soon(std::future<void> &f)
+    {
+        return f.wait_for(std::chrono::seconds(10))
+               == std::future_status::ready;
+    }
+
+    bool still_waiting(std::future<void> &f)
+    {
+        return f.wait_for(std::chrono::milliseconds(20))
+               == std::future_status::timeout;
+    }
+
+    void barrier_ignores_the_next_epoch()
+    {
+        larva::quiescence q(2);
+        unsigned const old_epoch = q.enter(0);
+        std::future<void> barrier = std::async(std::launch::async,
+                                               [&q] { q.barrier(); });
+
+        /* Count in shard 1 once the barrier has opened its epoch. */
+        unsigned new_epoch;
+        while ((new_epoch = q.enter(1)) == old_epoch) {
+            q.leave(1, new_epoch);
+            std::this_thread::yield();
+        }
+
+        /* A child of the old task belongs to the old epoch. */
+        q.enter(1, old_epoch);
+        q.leave(0, old_epoch);
+        CHECK(still_waiting(barrier));
+
+        q.leave(1, old_epoch);
+        CHECK(finishes_soon(barrier));
+        CHECK(!q.idle());
+
+        std::future<void> idle = std::async(std::launch::async,
+                                            [&q] { q.wait_idle(); });
+        CHECK(still_waiting(idle));
+        q.leave(1, new_epoch);
+        CHECK(finishes_soon(idle));
+        CHECK(q.idle());
+    }
+}
+
+int main()
+{
+    wait_idle_waits_for_nested_tasks();
+    barrier_ignores_the_next_epoch();
+    return larva_test::failures != 0;
+}
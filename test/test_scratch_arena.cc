@@ -0,0 +1,121 @@
+#include <cstdint>
+#include <memory_resource>
+#include <stdexcept>
+#include <vector>
+
+#include <thread_pool/thread_pool.hh>
+#include <thread_pool/scratch_arena.hh>
+
+#include "check.hh"
+
+namespace {
+
+    class counting_resource: public std::pmr::memory_resource {
+    public:
+        int allocations {0};
+
+    protected:
+        void *do_allocate(std::size_t bytes, std::size_t alignment) override
+        {
+            this->allocations++;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void *p,
+                           std::size_t bytes,
+                           std::size_t alignment) override
+        {
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other)
+                                            const noexcept override
+        {
+            return this == &other;
+        }
+    };
+
+    void rewind_returns_to_the_mark()
+    {
+        larva::scratch_arena arena;
+        void *kept = arena.allocate(100);
+        larva::scratch_arena::mark_type const mark = arena.mark();
+
+        void *first = arena.allocate(1000, 16);
+        CHECK(arena.allocate(5000) != first);
+        arena.rewind(mark);
+
+        CHECK(arena.allocate(1000, 16) == first);
+        CHECK(first != kept);
+        CHECK(reinterpret_cast<std::uintptr_t>(first) % 16 == 0);
+    }
+
+    void scope_rewinds_on_exceptions()
+    {
+        larva::scratch_arena arena;
+        void *before = nullptr;
+        {
+            larva::scratch_arena::scope scope(arena);
+            before = arena.allocate(64);
+        }
+
+        try {
+            larva::scratch_arena::scope scope(arena);
+            CHECK(arena.allocate(64) == before);
+            throw std::runtime_error("leaving the scope");
+        } catch (const std::runtime_error &) {
+        }
+
+        CHECK(arena.allocate(64) == before);
+    }
+
+    void chunks_survive_rewinds()
+    {
+        counting_resource upstream;
+        larva::scratch_arena arena(&upstream);
+        larva::scratch_arena::mark_type const empty = arena.mark();
+        int warm = 0;
+
+        for (int round = 0; round < 10; round++) {
+            /* Spills over several chunks, which only the first round asks
+             * upstream for. */
+            for (int i = 0; i < 64; i++) {
+                CHECK(arena.allocate(4096) != nullptr);
+            }
+
+            arena.rewind(empty);
+            if (round == 0) {
+                warm = upstream.allocations;
+            }
+        }
+
+        CHECK(warm > 1);
+        CHECK(upstream.allocations == warm);
+    }
+
+    void tasks_start_from_a_rewound_arena()
+    {
+        larva::thread_pool pool(1);
+        auto scratch = [] {
+            std::pmr::vector<int> v(&larva::this_task::arena());
+            v.resize(256, 7);
+            return static_cast<const void *>(v.data());
+        };
+
+        const void *first = pool.submit(scratch).get();
+        for (int i = 0; i < 20; i++) {
+            CHECK(pool.submit(scratch).get() == first);
+        }
+
+        CHECK(&larva::this_task::arena() == std::pmr::new_delete_resource());
+    }
+}
+
+int main()
+{
+    rewind_returns_to_the_mark();
+    scope_rewinds_on_exceptions();
+    chunks_survive_rewinds();
+    tasks_start_from_a_rewound_arena();
+    return larva_test::failures != 0;
+}
@@ -0,0 +1,92 @@
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <thread_pool/thread_pool.hh>
+#include <thread_pool/stealing_thread_pool.hh>
+
+#include "check.hh"
+
+namespace {
+
+    template <typename Pool>
+    bool submit_refused(Pool &pool)
+    {
+        try {
+            pool.submit([] {});
+        } catch (const std::runtime_error &) {
+            return true;
+        }
+
+        return false;
+    }
+
+    /* Every queued task runs, and so do the tasks they submit meanwhile. */
+    void drain_runs_everything()
+    {
+        std::atomic<int> ran {0};
+        larva::stealing_thread_pool pool(2);
+        for (int i = 0; i < 100; i++) {
+            pool.submit([&pool, &ran] {
+                ran++;
+                pool.submit([&ran] { ran++; });
+            });
+        }
+
+        pool.shutdown(larva::shutdown_mode::drain);
+        CHECK(ran == 200);
+        CHECK(submit_refused(pool));
+    }
+
+    /* The running task finishes, the queued ones are dropped. */
+    void now_breaks_queued_promises()
+    {
+        std::atomic<bool> started {false};
+        std::atomic<int> queued_ran {0};
+        larva::thread_pool pool(1);
+        std::future<int> running = pool.submit([&started] {
+            started = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            return 1;
+        });
+
+        std::vector<std::future<void>> queued;
+        for (int i = 0; i < 10; i++) {
+            queued.push_back(pool.submit([&queued_ran] { queued_ran++; }));
+        }
+
+        while (!started) {
+            std::this_thread::yield();
+        }
+
+        pool.shutdown(larva::shutdown_mode::now);
+        CHECK(running.get() == 1);
+        CHECK(queued_ran == 0);
+        for (std::future<void> &f: queued) {
+            bool broken = false;
+            try {
+                f.get();
+            } catch (const std::future_error &e) {
+                broken = e.code() == std::future_errc::broken_promise;
+            }
+
+            CHECK(broken);
+        }
+
+        CHECK(submit_refused(pool));
+
+        /* Again, and then the destructor: nothing left to do. */
+        pool.shutdown(larva::shutdown_mode::drain);
+        CHECK(queued_ran == 0);
+    }
+}
+
+int main()
+{
+    drain_runs_everything();
+    now_breaks_queued_promises();
+    return larva_test::failures != 0;
+}
@@ -0,0 +1,119 @@
+#include <atomic>
+#include <memory_resource>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <thread_pool/thread_pool.hh>
+#include <thread_pool/task_slab.hh>
+
+#include "check.hh"
+
+namespace {
+
+    /* Thread-safe resource that remembers how much it handed out. */
+    class counting_resource: public std::pmr::memory_resource {
+    public:
+        std::atomic<long> allocations {0};
+        std::atomic<long> outstanding {0};
+
+    protected:
+        void *do_allocate(std::size_t bytes, std::size_t alignment) override
+        {
+            this->allocations++;
+            this->outstanding += static_cast<long>(bytes);
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void *p,
+                           std::size_t bytes,
+                           std::size_t alignment) override
+        {
+            this->outstanding -= static_cast<long>(bytes);
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other)
+                                            const noexcept override
+        {
+            return this == &other;
+        }
+    };
+
+    void owner_frees_reuse_blocks()
+    {
+        counting_resource upstream;
+        larva::task_slab slab(&upstream);
+        slab.bind_to_current_thread();
+
+        void *a = slab.allocate(48);
+        slab.deallocate(a, 48);
+        CHECK(slab.allocate(64) == a);
+        CHECK(upstream.allocations == 1);
+
+        /* Too big for a size class: straight to upstream, and back. */
+        void *big = slab.allocate(4096);
+        CHECK(upstream.allocations == 2);
+        slab.deallocate(big, 4096);
+        CHECK(upstream.outstanding == larva::task_slab::chunk_size);
+    }
+
+    void remote_frees_come_back_to_the_owner()
+    {
+        constexpr int count = 100;
+        counting_resource upstream;
+        larva::task_slab slab(&upstream);
+        slab.bind_to_current_thread();
+
+        std::vector<void *> blocks;
+        for (int i = 0; i < count; i++) {
+            blocks.push_back(slab.allocate(200));
+        }
+
+        std::thread other([&] {
+            for (void *p: blocks) {
+                slab.deallocate(p, 200);
+            }
+        });
+        other.join();
+
+        /* The owner takes the whole remote list over: the same blocks,
+         * nothing new from upstream. */
+        long const chunks = upstream.allocations;
+        std::set<void *> freed(blocks.begin(), blocks.end());
+        for (int i = 0; i < count; i++) {
+            CHECK(freed.erase(slab.allocate(256)) == 1);
+        }
+
+        CHECK(freed.empty());
+        CHECK(upstream.allocations == chunks);
+    }
+
+    void pmr_submit_gives_everything_back()
+    {
+        counting_resource resource;
+        {
+            larva::thread_pool pool(2);
+            std::vector<std::future<int>> results;
+            for (int i = 0; i < 50; i++) {
+                results.push_back(pool.submit(&resource, [i] { return i * i; }));
+            }
+
+            pool.wait_idle();
+            for (int i = 0; i < 50; i++) {
+                CHECK(results[i].get() == i * i);
+            }
+        }
+
+        CHECK(resource.allocations >= 100);
+        CHECK(resource.outstanding == 0);
+    }
+}
+
+int main()
+{
+    owner_frees_reuse_blocks();
+    remote_frees_come_back_to_the_owner();
+    pmr_submit_gives_everything_back();
+    return larva_test::failures != 0;
+}
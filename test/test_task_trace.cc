@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <thread_pool/stealing_thread_pool.hh>
+#include <thread_pool/task_trace.hh>
+
+#include "check.hh"
+
+namespace {
+
+    larva::trace_event event(std::uint64_t i)
+    {
+        return {static_cast<std::int64_t>(i), i, 3 * i,
+                static_cast<std::uint32_t>(i % 7),
+                larva::trace_event_type::task_begin};
+    }
+
+    bool consistent(const larva::trace_event &e)
+    {
+        return e.ts == static_cast<std::int64_t>(e.task)
+               && e.parent == 3 * e.task && e.lane == e.task % 7
+               && e.type == larva::trace_event_type::task_begin;
+    }
+
+    void full_ring_keeps_the_newest()
+    {
+        larva::trace_ring ring(5);
+        std::vector<larva::trace_event> events;
+        for (std::uint64_t i = 1; i <= 3; i++) {
+            ring.push(event(i));
+        }
+
+        ring.collect(events);
+        CHECK(events.size() == 3);
+
+        /* Rounded up to 8 slots: 20 events leave 13 to 20. */
+        for (std::uint64_t i = 4; i <= 20; i++) {
+            ring.push(event(i));
+        }
+
+        events.clear();
+        ring.collect(events);
+        CHECK(events.size() == 8);
+        for (std::size_t i = 0; i < events.size(); i++) {
+            CHECK(events[i].task == 13 + i);
+            CHECK(consistent(events[i]));
+        }
+    }
+
+    /* A reader racing the writer only gets whole events, oldest first. */
+    void collect_never_tears()
+    {
+        larva::trace_ring ring(16);
+        std::atomic<bool> done {false};
+        std::thread writer([&] {
+            for (std::uint64_t i = 1; !done; i++) {
+                ring.push(event(i));
+            }
+        });
+
+        std::uint64_t seen = 0;
+        std::vector<larva::trace_event> events;
+        for (int round = 0; round < 500; round++) {
+            events.clear();
+            ring.collect(events);
+            for (std::size_t i = 0; i < events.size(); i++) {
+                CHECK(consistent(events[i]));
+                CHECK(i == 0 || events[i - 1].task < events[i].task);
+            }
+
+            seen += events.size();
+            std::this_thread::yield();
+        }
+
+        done = true;
+        writer.join();
+        CHECK(seen > 0);
+    }
+
+    void pool_records_every_task()
+    {
+        larva::stealing_thread_pool pool(2);
+        pool.start_tracing(1024);
+        for (int i = 0; i < 20; i++) {
+            pool.submit([&pool] { pool.submit([] {}); });
+        }
+
+        pool.wait_idle();
+        pool.stop_tracing();
+
+        std::map<std::uint64_t, int> begins;
+        std::map<std::uint64_t, int> ends;
+        int submits = 0;
+        int children = 0;
+        for (const larva::trace_event &e: pool.trace_events()) {
+            switch (e.type) {
+            case larva::trace_event_type::submit:
+                submits++;
+                children += e.parent != 0;
+                break;
+            case larva::trace_event_type::task_begin:
+                begins[e.task]++;
+                break;
+            case larva::trace_event_type::task_end:
+                ends[e.task]++;
+                break;
+            default:
+                break;
+            }
+        }
+
+        CHECK(submits == 40);
+        CHECK(children == 20);
+        CHECK(begins.size() == 40);
+        CHECK(begins == ends);
+
+        std::ostringstream json;
+        pool.write_trace(json);
+        CHECK(json.str().rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[",
+                               0) == 0);
+    }
+
+    bool same(const std::vector<larva::trace_event> &a,
+              const std::vector<larva::trace_event> &b)
+    {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                          [](const larva::trace_event &x,
+                             const larva::trace_event &y) {
+                              return x.ts == y.ts && x.task == y.task
+                                     && x.parent == y.parent
+                                     && x.lane == y.lane && x.type == y.type;
+                          });
+    }
+
+    void saved_traces_load_back()
+    {
+        std::vector<larva::trace_event> events;
+        for (std::uint64_t i = 1; i <= 100; i++) {
+            events.push_back({static_cast<std::int64_t>(1000 * i), i, i / 2,
+                              static_cast<std::uint32_t>(i % 5),
+                              static_cast<larva::trace_event_type>(i % 6)});
+        }
+
+        std::stringstream dump;
+        larva::save_trace(dump, events, 4);
+        std::string const bytes = dump.str();
+
+        std::vector<larva::trace_event> loaded;
+        unsigned workers = 0;
+        CHECK(larva::load_trace(dump, loaded, workers));
+        CHECK(workers == 4);
+        CHECK(same(loaded, events));
+
+        /* A dump cut short keeps the whole events before the cut. */
+        std::istringstream truncated(bytes.substr(0, bytes.size() - 40));
+        loaded.clear();
+        CHECK(!larva::load_trace(truncated, loaded, workers));
+        CHECK(loaded.size() == 98);
+        CHECK(same(loaded, {events.begin(), events.begin() + 98}));
+
+        std::istringstream other("not a trace dump at all");
+        loaded.clear();
+        CHECK(!larva::load_trace(other, loaded, workers));
+        CHECK(loaded.empty());
+    }
+
+    /* Task 1 submits 2 after 10 ns of its work and 3 after 20 ns. Task 3
+     * submits 4 after 20 ns and runs it inline. Own work: 100, 60, 120 and
+     * 30 ns. The longest chain is 20 ns of 1 and all of 3's own work. */
+    void work_span_of_a_known_graph()
+    {
+        typedef larva::trace_event_type type;
+        std::vector<larva::trace_event> const events {
+            {100, 1, 0, 0, type::task_begin},
+            {110, 2, 1, 0, type::submit},
+            {112, 2, 0, 1, type::steal},
+            {115, 2, 1, 1, type::task_begin},
+            {120, 3, 1, 0, type::submit},
+            {175, 2, 1, 1, type::task_end},
+            {180, 3, 1, 1, type::task_begin},
+            {200, 4, 3, 1, type::submit},
+            {200, 1, 0, 0, type::task_end},
+            {210, 4, 3, 1, type::task_begin},
+            {240, 4, 3, 1, type::task_end},
+            {330, 3, 1, 1, type::task_end},
+        };
+
+        larva::work_span const ws = larva::work_span::of(events, 2);
+        CHECK(ws.tasks == 4);
+        CHECK(ws.steals == 1);
+        CHECK(ws.work == 310);
+        CHECK(ws.span == 140);
+        CHECK(ws.first == 100);
+        CHECK(ws.last == 330);
+        CHECK(ws.parallelism() > 2.21 && ws.parallelism() < 2.22);
+        CHECK(ws.greedy(1) > 0.68 && ws.greedy(1) < 0.69);
+
+        /* Without its end, task 3 and the task it ran drop out. */
+        std::vector<larva::trace_event> const cut(events.begin(),
+                                                  events.end() - 1);
+        larva::work_span const partial = larva::work_span::of(cut, 2);
+        CHECK(partial.tasks == 3);
+        CHECK(partial.work == 100 + 60 + 30);
+        CHECK(partial.span == 100);
+    }
+}
+
+int main()
+{
+    full_ring_keeps_the_newest();
+    collect_never_tears();
+    pool_records_every_task();
+    saved_traces_load_back();
+    work_span_of_a_known_graph();
+    return larva_test::failures != 0;
+}
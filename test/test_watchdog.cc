@@ -0,0 +1,174 @@
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <thread_pool/thread_pool.hh>
+#include <thread_pool/watchdog.hh>
+
+#include "check.hh"
+
+namespace {
+
+    typedef larva::watchdog<larva::thread_pool> watchdog;
+
+    /* Runs a labeled task on the pool until released. */
+    class held_task {
+        std::atomic<bool> _started {false};
+        std::atomic<bool> _release {false};
+        std::future<void> _done;
+
+    public:
+        held_task(larva::thread_pool &pool, larva::task_label label):
+            _done {pool.submit(label, [this] {
+                this->_started = true;
+                while (!this->_release) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            })}
+        {
+            while (!this->_started) {
+                std::this_thread::yield();
+            }
+        }
+
+        ~held_task()
+        {
+            this->_release = true;
+            this->_done.get();
+        }
+    };
+
+    bool running(const larva::pool_state &state, larva::task_label label)
+    {
+        return state.workers.size() == 1 && state.workers[0].running
+               && state.workers[0].label == label.id();
+    }
+
+    void inspect_sees_watched_tasks()
+    {
+        larva::task_label const label("test.inspected");
+        larva::thread_pool pool(1);
+        {
+            held_task task(pool, label);
+            CHECK(!pool.inspect().workers[0].running);
+        }
+
+        /* Watching nests: off only once every caller turned it off. */
+        pool.watch_tasks(true);
+        pool.watch_tasks(true);
+        pool.watch_tasks(false);
+        {
+            held_task task(pool, label);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            larva::pool_state const state = pool.inspect();
+            CHECK(running(state, label));
+            CHECK(state.workers[0].running_ns >= 5000000u);
+            CHECK(state.workers[0].task_since_ns > 0);
+        }
+
+        pool.wait_idle();
+        CHECK(!pool.inspect().workers[0].running);
+
+        pool.watch_tasks(false);
+        pool.watch_tasks(false);
+        {
+            held_task task(pool, label);
+            CHECK(!pool.inspect().workers[0].running);
+        }
+    }
+
+    void stuck_tasks_are_reported_once()
+    {
+        larva::task_label const label("test.stuck");
+        larva::thread_pool pool(1);
+        std::atomic<int> reports {0};
+        std::atomic<unsigned> reported_label {0};
+        {
+            watchdog dog(pool, std::chrono::milliseconds(10),
+                         [&](unsigned, const larva::worker_state &w) {
+                             reports++;
+                             reported_label = w.label;
+                         },
+                         std::chrono::milliseconds(2));
+            held_task task(pool, label);
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+
+        CHECK(reports == 1);
+        CHECK(reported_label == label.id());
+    }
+
+    std::atomic<int> own_handler_calls {0};
+
+    void own_handler(int)
+    {
+        own_handler_calls++;
+    }
+
+    std::string contents(const std::string &path)
+    {
+        std::ifstream in(path);
+        return {std::istreambuf_iterator<char>(in), {}};
+    }
+
+    /* Every watchdog on the signal dumps, and the handler it replaced
+     * comes back after the last one. */
+    void signals_dump_every_watchdog()
+    {
+        struct sigaction own {};
+        own.sa_handler = &own_handler;
+        sigemptyset(&own.sa_mask);
+        sigaction(SIGUSR1, &own, nullptr);
+
+        char first[] = "/tmp/larva_testXXXXXX";
+        char second[] = "/tmp/larva_testXXXXXX";
+        ::close(::mkstemp(first));
+        ::close(::mkstemp(second));
+
+        larva::thread_pool pool(1);
+        {
+            auto const never = [](unsigned, const larva::worker_state &) {};
+            watchdog a(pool, std::chrono::seconds(10), never,
+                       std::chrono::milliseconds(2));
+            watchdog b(pool, std::chrono::seconds(10), never,
+                       std::chrono::milliseconds(2));
+            a.dump_on_signal(SIGUSR1, first);
+            b.dump_on_signal(SIGUSR1, second);
+            ::raise(SIGUSR1);
+
+            for (int i = 0; i < 5000; i++) {
+                if (!contents(first).empty() && !contents(second).empty()) {
+                    break;
+                }
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        CHECK(!contents(first).empty());
+        CHECK(!contents(second).empty());
+        CHECK(own_handler_calls == 0);
+
+        ::raise(SIGUSR1);
+        CHECK(own_handler_calls == 1);
+
+        ::unlink(first);
+        ::unlink(second);
+    }
+}
+
+int main()
+{
+    inspect_sees_watched_tasks();
+    stuck_tasks_are_reported_once();
+    signals_dump_every_watchdog();
+    return larva_test::failures != 0;
+}
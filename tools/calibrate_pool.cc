@@ -0,0 +1,49 @@
+/**
+ * @brief       - Calibrate `stealing_thread_pool` on this host and write the
+ *                parameters to a config file, which
+ *                `larva::tuned_config()` and `pool_config::load()` read at
+ *                startup. Prints every candidate it tried.
+ *
+ * Usage: calibrate_pool [--max-threads N] <config>
+ */
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <thread_pool/autotune.hh>
+#include <thread_pool/stealing_thread_pool.hh>
+
+int main(int argc, char **argv)
+{
+    unsigned max_threads = std::thread::hardware_concurrency();
+    std::string path;
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "--max-threads") && i + 1 < argc) {
+            max_threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (path.empty()) {
+            path = argv[i];
+        } else {
+            path.clear();
+            break;
+        }
+    }
+
+    if (path.empty() || max_threads == 0) {
+        std::cerr << "usage: " << argv[0] << " [--max-threads N] <config>"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    larva::pool_config const config =
+        larva::calibrate<larva::stealing_thread_pool>(max_threads, &std::cerr);
+    if (!config.save(path)) {
+        std::cerr << path << ": can not write the config" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "threads = " << config.threads << ", spin_count = "
+              << config.spin_count << ", saved to " << path << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,183 @@
+/**
+ * @brief       - Turn a binary log, written by the deferred logger with
+ *                `output::binary`, into the text the logger would have
+ *                written. With `-t`, each line starts with its time in
+ *                seconds since the epoch.
+ *
+ * Usage: log_decode [-t] [file]
+ */
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <logger/binary_log.hh>
+#include <logger/log_format.hh>
+
+namespace {
+
+    /* Its strings point into the log. */
+    struct site {
+        bool defined {false};
+        larva::log_level level {};
+        std::uint32_t line {0};
+        std::string_view file {};
+        std::string_view function {};
+        bool formatted {false};
+        std::vector<larva::format_segment> segments {};
+    };
+
+    bool define(std::uint32_t id, larva::binary_log::reader &r,
+                std::vector<site> &sites)
+    {
+        std::uint8_t level;
+        std::uint8_t tag;
+        site s;
+        if (!r.get(level) || !r.get(s.line) || !r.get(tag)
+            || !r.get_string(s.file) || !r.get(tag)
+            || !r.get_string(s.function))
+        {
+            return false;
+        }
+
+        s.defined = true;
+        s.level = static_cast<larva::log_level>(level);
+        if (!r.done()) {
+            std::string_view format;
+            if (!r.get(tag) || !r.get_string(format)) {
+                return false;
+            }
+
+            try {
+                s.segments.resize(larva::parse_format(format));
+                larva::parse_format(format, s.segments.data());
+            } catch (const std::invalid_argument &) {
+                return false;
+            }
+            s.formatted = true;
+        }
+
+        if (id >= sites.size()) {
+            sites.resize(id + 1);
+        }
+
+        sites[id] = std::move(s);
+        return true;
+    }
+
+    /* Returns false if the log is malformed. */
+    bool decode(const std::string &log, bool times, std::ostream &os)
+    {
+        std::vector<site> sites;
+        std::string line;
+        std::size_t at = 0;
+        while (at < log.size()) {
+            /* A new file, or a new run appended to the same one. */
+            if (!log.compare(at, sizeof(larva::binary_log::magic),
+                             larva::binary_log::magic,
+                             sizeof(larva::binary_log::magic)))
+            {
+                sites.clear();
+                at += sizeof(larva::binary_log::magic);
+                continue;
+            }
+
+            std::uint32_t size;
+            std::uint32_t id;
+            std::int64_t time_ns;
+            larva::binary_log::reader header(log.data() + at, log.size() - at);
+            if (!header.get(size) || !header.get(id) || !header.get(time_ns)
+                || size < larva::binary_log::header_size
+                || size > log.size() - at)
+            {
+                return false;
+            }
+
+            larva::binary_log::reader r(
+                log.data() + at + larva::binary_log::header_size,
+                size - larva::binary_log::header_size);
+            at += size;
+            if (id & larva::binary_log::site_definition) {
+                if (!define(id & ~larva::binary_log::site_definition, r,
+                            sites))
+                {
+                    return false;
+                }
+
+                continue;
+            }
+
+            if (id >= sites.size() || !sites[id].defined) {
+                return false;
+            }
+
+            const site &s = sites[id];
+            line.clear();
+            if (times) {
+                char stamp[32];
+                std::snprintf(stamp, sizeof(stamp), "%lld.%09lld ",
+                              static_cast<long long>(time_ns / 1000000000),
+                              static_cast<long long>(time_ns % 1000000000));
+                line += stamp;
+            }
+
+            larva::binary_log::format_header(s.level, s.file, s.line,
+                                             s.function, line);
+            bool const valid = s.formatted
+                ? larva::binary_log::format_arguments(
+                      r, s.segments.data(), s.segments.size(), line)
+                : larva::binary_log::format_arguments(r, line);
+            if (!valid) {
+                return false;
+            }
+
+            os << line << '\n';
+        }
+
+        return true;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bool times = false;
+    const char *path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "-t")) {
+            times = true;
+        } else if (!path) {
+            path = argv[i];
+        } else {
+            std::cerr << "usage: " << argv[0] << " [-t] [file]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::string log;
+    if (path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            std::cerr << path << ": can not read the log" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        log.assign(std::istreambuf_iterator<char>(in), {});
+    } else {
+        log.assign(std::istreambuf_iterator<char>(std::cin), {});
+    }
+
+    if (!decode(log, times, std::cout)) {
+        std::cerr << (path ? path : "stdin") << ": malformed log"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
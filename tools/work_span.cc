@@ -0,0 +1,134 @@
+/**
+ * @brief       - Work/span analysis of a task trace, in the manner of
+ *                Cilkview. Reads a dump of `larva::save_trace()` and reports:
+ *                - work: the time spent in tasks, without the tasks they ran
+ *                  inline while waiting.
+ *                - span: the longest chain of dependent work. A child can not
+ *                  start before its parent has done the work preceding its
+ *                  submit, and a task is not over before its children are.
+ *                - parallelism: work / span, the most cores the job can use.
+ *                - the speedup at P cores: at least work / (work / P + span)
+ *                  under a greedy scheduler, at most min(P, parallelism),
+ *                  and the one measured on the traced pool.
+ *                A task blocked on a future counts as working, so waiting
+ *                with `run_pending_task()` gives a tighter estimate.
+ *
+ * Usage: work_span <trace> [cores...], each core count a number above 0.
+ */
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <thread_pool/task_trace.hh>
+
+namespace {
+
+    double ms(double ns)
+    {
+        return ns / 1e6;
+    }
+
+    /* Core counts, each a whole positive number, or the powers of two up
+     * to 64 when none is given. */
+    bool parse_cores(int argc, char **argv, std::vector<unsigned> &cores)
+    {
+        for (int i = 2; i < argc; i++) {
+            char *end = nullptr;
+            errno = 0;
+            unsigned long const p = std::strtoul(argv[i], &end, 10);
+            if (end == argv[i] || *end || errno || argv[i][0] == '-'
+                || p == 0 || p > std::numeric_limits<unsigned>::max())
+            {
+                return false;
+            }
+
+            cores.push_back(static_cast<unsigned>(p));
+        }
+
+        if (cores.empty()) {
+            for (unsigned p = 1; p <= 64; p *= 2) {
+                cores.push_back(p);
+            }
+        }
+
+        return true;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<unsigned> cores;
+    if (argc < 2 || !parse_cores(argc, argv, cores)) {
+        std::cerr << "usage: " << argv[0] << " <trace> [cores...]"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream in(argv[1], std::ios::binary);
+    std::vector<larva::trace_event> events;
+    unsigned workers = 0;
+    if (!larva::load_trace(in, events, workers)) {
+        std::cerr << argv[1] << ": not a complete trace dump" << std::endl;
+        if (events.empty()) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    larva::work_span const ws = larva::work_span::of(std::move(events),
+                                                     workers);
+    if (ws.tasks == 0 || ws.span == 0) {
+        std::cerr << argv[1] << ": no complete task in the trace"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    double const parallelism = ws.parallelism();
+    double const wall = static_cast<double>(ws.last - ws.first);
+
+    if (workers && std::find(cores.begin(), cores.end(), workers)
+                    == cores.end())
+    {
+        cores.push_back(workers);
+        std::sort(cores.begin(), cores.end());
+    }
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "tasks        " << ws.tasks << " on " << workers
+              << " workers, " << ws.steals << " steals\n"
+              << "wall         " << ms(wall) << " ms\n"
+              << "work         " << ms(ws.work) << " ms\n"
+              << "span         " << ms(ws.span) << " ms\n"
+              << "parallelism  " << std::setprecision(2) << parallelism
+              << "\n\n"
+              << std::setw(6) << "cores" << std::setw(12) << "at least"
+              << std::setw(12) << "at most" << "\n";
+    for (unsigned p: cores) {
+        std::cout << std::setw(6) << p
+                  << std::setw(12) << ws.greedy(p)
+                  << std::setw(12) << std::min<double>(p, parallelism) << "\n";
+    }
+
+    if (workers) {
+        double const measured = ws.work / wall;
+        std::cout << "\nmeasured on " << workers << " workers: " << measured
+                  << "x, greedy bound " << ws.greedy(workers) << "x\n";
+        if (measured < 0.8 * ws.greedy(workers)) {
+            std::cout << "below the bound: time goes to scheduling "
+                         "overhead\n";
+        } else if (parallelism < workers) {
+            std::cout << "bound by the span: the job lacks parallelism\n";
+        } else {
+            std::cout << "within the bound\n";
+        }
+    }
+
+    return EXIT_SUCCESS;
+}